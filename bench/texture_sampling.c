@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "texture.h"
+
+#define SCREEN_SIZE 512
+#define REPETITIONS 8
+
+// How a surface maps screen pixels to texels: moving one pixel right adds (dudx, dvdx)
+// texels, moving one row down adds (dudy, dvdy).
+typedef struct {
+    const char* name;
+    float dudx, dvdx;
+    float dudy, dvdy;
+} surface_t;
+
+// Texel index functions being compared.
+static int rowMajorTexelIndex(int x, int y, int width)
+{
+    return y * width + x;
+}
+
+typedef int (*texelIndexFunction)(int x, int y, int width);
+
+// Fills a texture with the same texel values in the given layout, so both layouts return
+// the same checksum when the addressing is right.
+static uint32_t* createTexels(int size, texelIndexFunction texelIndex)
+{
+    uint32_t* texels = malloc(sizeof(uint32_t) * size * size);
+
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            texels[texelIndex(x, y, size)] = (uint32_t)(x * 2654435761u) ^ (uint32_t)(y * 40503u);
+        }
+    }
+
+    return texels;
+}
+
+// Samples a SCREEN_SIZE x SCREEN_SIZE region of a surface with nearest filtering and
+// wrapping, as the rasterizer does, and returns a checksum of the texels read.
+// `*seconds` receives the processor time spent.
+static uint32_t sampleSurface(
+    const uint32_t* texels, int size, const surface_t* surface,
+    texelIndexFunction texelIndex, double* seconds
+) {
+    uint32_t checksum = 0;
+    clock_t start = clock();
+
+    for (int r = 0; r < REPETITIONS; r++)
+    {
+        for (int py = 0; py < SCREEN_SIZE; py++)
+        {
+            float u = py * surface->dudy + r * 7;
+            float v = py * surface->dvdy + r * 3;
+
+            for (int px = 0; px < SCREEN_SIZE; px++)
+            {
+                int x = abs((int)u) & (size - 1);
+                int y = abs((int)v) & (size - 1);
+
+                checksum += texels[texelIndex(x, y, size)];
+
+                u += surface->dudx;
+                v += surface->dvdx;
+            }
+        }
+    }
+
+    *seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    return checksum;
+}
+
+// Compares the sampling throughput of row-major and tiled textures of several sizes, for
+// surfaces that face the camera, are rotated in screen space, or are seen at a grazing
+// angle (where consecutive pixels step several texels along v, walking down the texture's
+// columns).
+int main()
+{
+    const int sizes[] = { 64, 256, 1024, 2048 };
+    const float angle = M_PI / 4;
+    const surface_t surfaces[] = {
+        { "facing", 1, 0, 0, 1 },
+        { "rotated 45", cosf(angle), sinf(angle), -sinf(angle), cosf(angle) },
+        { "rotated 90", 0, 1, -1, 0 },
+        { "oblique", 1, 0, 0, 4 },
+        { "oblique 90", 0, 4, -1, 0 },
+    };
+
+    printf("%-12s %6s %14s %14s %8s\n", "surface", "size", "row-major", "tiled", "speedup");
+
+    for (int s = 0; s < sizeof(surfaces) / sizeof(surfaces[0]); s++)
+    {
+        for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        {
+            int size = sizes[i];
+            uint32_t* rowMajor = createTexels(size, rowMajorTexelIndex);
+            uint32_t* tiled = createTexels(size, tiledTexelIndex);
+            double rowMajorSeconds, tiledSeconds;
+
+            uint32_t rowMajorChecksum = sampleSurface(rowMajor, size, &surfaces[s], rowMajorTexelIndex, &rowMajorSeconds);
+            uint32_t tiledChecksum = sampleSurface(tiled, size, &surfaces[s], tiledTexelIndex, &tiledSeconds);
+
+            if (rowMajorChecksum != tiledChecksum)
+            {
+                printf("%s %d: checksum mismatch\n", surfaces[s].name, size);
+                return 1;
+            }
+
+            double texels = (double)SCREEN_SIZE * SCREEN_SIZE * REPETITIONS / 1e6;
+
+            printf("%-12s %6d %9.1f Mt/s %9.1f Mt/s %7.2fx\n",
+                surfaces[s].name, size,
+                texels / rowMajorSeconds, texels / tiledSeconds,
+                rowMajorSeconds / tiledSeconds);
+
+            free(rowMajor);
+            free(tiled);
+        }
+    }
+
+    return 0;
+}
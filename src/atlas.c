@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "atlas.h"
+#include "mesh.h"
+
+// A texture placed in the atlas: its texels start at (x, y), inside the gutters.
+typedef struct {
+    const textureImage_t* texture;
+    int x, y;
+} atlasEntry_t;
+
+static atlasEntry_t entries[MAX_TEXTURES];
+static int numberEntries = 0;
+static const textureImage_t* atlas = NULL;
+static int usedTexels = 0;
+
+static inline int minInt(int a, int b) { return a < b ? a : b; }
+static inline int maxInt(int a, int b) { return a > b ? a : b; }
+
+// Size a texture side takes in the atlas: the side and its two gutters, rounded up to a
+// multiple of the gutter so the next texture also starts at a multiple of it.
+static int paddedSize(int size)
+{
+    return (size + 3 * ATLAS_GUTTER - 1) / ATLAS_GUTTER * ATLAS_GUTTER;
+}
+
+// Whether a mesh's texture coordinates can be moved into the atlas: only when none leaves
+// [0, 1], whatever the texture's wrap mode. Outside of it, a repeating texture would not
+// repeat and a clamped one would not clamp to its edge, but sample past its gutter into
+// its neighbours.
+static bool canUseAtlas(const mesh_t* mesh)
+{
+    for (int f = 0; f < array_length(mesh->faces); f++)
+    {
+        const texture_t uv[3] = { mesh->faces[f].aUV, mesh->faces[f].bUV, mesh->faces[f].cUV };
+
+        for (int i = 0; i < 3; i++)
+        {
+            if (uv[i].u < 0 || uv[i].u > 1 || uv[i].v < 0 || uv[i].v > 1) return false;
+        }
+    }
+
+    return true;
+}
+
+// Orders atlas entries from the tallest texture to the shortest.
+static int compareEntryHeights(const void* a, const void* b)
+{
+    return ((const atlasEntry_t*)b)->texture->height - ((const atlasEntry_t*)a)->texture->height;
+}
+
+// Places the entries on shelves: rows of textures laid left to right, each as tall as its
+// tallest texture. With the entries sorted by height, shelves waste little space.
+// Returns false when they do not fit in `width` x `height` texels.
+static bool packShelves(int width, int height)
+{
+    int shelfX = 0;
+    int shelfY = 0;
+    int shelfHeight = 0;
+
+    for (int i = 0; i < numberEntries; i++)
+    {
+        int entryWidth = paddedSize(entries[i].texture->width);
+        int entryHeight = paddedSize(entries[i].texture->height);
+
+        if (shelfX + entryWidth > width)
+        {
+            shelfX = 0;
+            shelfY += shelfHeight;
+            shelfHeight = 0;
+        }
+
+        if (entryWidth > width || shelfY + entryHeight > height) return false;
+
+        entries[i].x = shelfX + ATLAS_GUTTER;
+        entries[i].y = shelfY + ATLAS_GUTTER;
+
+        shelfX += entryWidth;
+        shelfHeight = maxInt(shelfHeight, entryHeight);
+    }
+
+    return true;
+}
+
+// Copies an entry's base level into the row-major atlas page, surrounded by gutters that
+// repeat its edge texels.
+static void copyEntry(uint32_t* page, int pageWidth, const atlasEntry_t* entry)
+{
+    const textureImage_t* texture = entry->texture;
+
+    for (int y = -ATLAS_GUTTER; y < texture->height + ATLAS_GUTTER; y++)
+    {
+        int textureY = minInt(maxInt(y, 0), texture->height - 1);
+
+        for (int x = -ATLAS_GUTTER; x < texture->width + ATLAS_GUTTER; x++)
+        {
+            int textureX = minInt(maxInt(x, 0), texture->width - 1);
+
+            page[(entry->y + y) * pageWidth + entry->x + x] =
+                texture->texels[tiledTexelIndex(textureX, textureY, texture->levelStrides[0])];
+        }
+    }
+}
+
+// Packs the textures of the scene's meshes into one atlas page and points the meshes at it.
+// Called once after the meshes and their textures are loaded. Every face's UVs are rewritten
+// from its own texture's space into the page's, so the whole scene samples a single texture
+// and the rasterizer never switches textures between triangles.
+// Meshes with coordinates outside [0, 1] keep their texture (see `canUseAtlas`), as repeating
+// or clamping it needs the texture's own edges. Returns the
+// atlas, or NULL when fewer than two textures can share one or they do not fit in a page.
+//
+// Math:
+// 1. A texture of w x h texels placed at (x, y) in a W x H page covers u in [x/W, (x + w)/W],
+//    so a coordinate u in the texture becomes (x + u * w) / W in the page (likewise for v).
+// 2. The page starts as the smallest power-of-two square holding the padded area of every
+//    texture, and is doubled (alternately in width and height) until the shelves fit.
+const textureImage_t* buildMeshTextureAtlas()
+{
+    numberEntries = 0;
+    usedTexels = 0;
+
+    for (int m = 0; m < getNumberMeshes(); m++)
+    {
+        const textureImage_t* texture = getMesh(m)->texture;
+        bool isNew = texture != NULL;
+
+        for (int i = 0; i < numberEntries; i++)
+        {
+            if (entries[i].texture == texture) isNew = false;
+        }
+
+        if (isNew) entries[numberEntries++] = (atlasEntry_t){ texture, 0, 0 };
+    }
+
+    // A texture stays out of the atlas when any of its meshes repeats it.
+    for (int m = 0; m < getNumberMeshes(); m++)
+    {
+        const mesh_t* mesh = getMesh(m);
+        if (mesh->texture == NULL || canUseAtlas(mesh)) continue;
+
+        for (int i = 0; i < numberEntries; i++)
+        {
+            if (entries[i].texture != mesh->texture) continue;
+
+            entries[i] = entries[numberEntries - 1];
+            numberEntries--;
+            break;
+        }
+    }
+
+    if (numberEntries < 2) return NULL;
+
+    qsort(entries, numberEntries, sizeof(atlasEntry_t), compareEntryHeights);
+
+    int paddedTexels = 0;
+
+    for (int i = 0; i < numberEntries; i++)
+    {
+        paddedTexels += paddedSize(entries[i].texture->width) * paddedSize(entries[i].texture->height);
+    }
+
+    int width = 1;
+    while (width * width < paddedTexels) width *= 2;
+    int height = width;
+
+    while (!packShelves(width, height))
+    {
+        if (width == height) width *= 2;
+        else height *= 2;
+
+        if (width > ATLAS_MAX_SIZE) return NULL;
+    }
+
+    uint32_t* page = calloc(width * height, sizeof(uint32_t));
+
+    for (int i = 0; i < numberEntries; i++)
+    {
+        copyEntry(page, width, &entries[i]);
+        usedTexels += entries[i].texture->width * entries[i].texture->height;
+    }
+
+    textureImage_t* pageTexture = createTexture(page, width, height, TEXTURE_WRAP_CLAMP);
+    free(page);
+
+    if (pageTexture == NULL) return NULL;
+
+    pageTexture->mipLevels = minInt(pageTexture->mipLevels, ATLAS_MIP_LEVELS);
+
+    for (int m = 0; m < getNumberMeshes(); m++)
+    {
+        mesh_t* mesh = getMesh(m);
+
+        for (int i = 0; i < numberEntries; i++)
+        {
+            if (mesh->texture != entries[i].texture) continue;
+
+            const textureImage_t* texture = entries[i].texture;
+
+            for (int f = 0; f < array_length(mesh->faces); f++)
+            {
+                texture_t* uv[3] = { &mesh->faces[f].aUV, &mesh->faces[f].bUV, &mesh->faces[f].cUV };
+
+                for (int v = 0; v < 3; v++)
+                {
+                    uv[v]->u = (entries[i].x + uv[v]->u * texture->width) / width;
+                    uv[v]->v = (entries[i].y + uv[v]->v * texture->height) / height;
+                }
+            }
+
+            mesh->texture = pageTexture;
+            break;
+        }
+    }
+
+    atlas = pageTexture;
+
+    return atlas;
+}
+
+// Prints how well the textures were packed: the share of the atlas page holding texels of
+// the packed textures (the rest is gutters and unused space).
+void printAtlasStats()
+{
+    if (atlas == NULL)
+    {
+        printf("texture atlas: not built\n");
+        return;
+    }
+
+    printf("texture atlas: %d textures in %dx%d texels, %.1f%% of the page used\n",
+        numberEntries, atlas->width, atlas->height, 100.0f * usedTexels / (atlas->width * atlas->height));
+}
@@ -0,0 +1,21 @@
+#ifndef ATLAS
+#define ATLAS
+
+#include "texture.h"
+
+// Texels of padding around every texture packed into the atlas. The gutters repeat the
+// texture's edge texels, so filtering and mip levels never pull in a neighbour's texels.
+#define ATLAS_GUTTER 8
+
+// Textures are placed at multiples of the gutter, so the first ATLAS_MIP_LEVELS levels of the
+// atlas average each texture only with itself and its gutter (a gutter of 8 texels is still
+// one texel wide at level 3). Smaller levels would mix neighbouring textures and are dropped.
+#define ATLAS_MIP_LEVELS 4
+
+// Largest side of the atlas page, in texels.
+#define ATLAS_MAX_SIZE 8192
+
+const textureImage_t* buildMeshTextureAtlas();
+void printAtlasStats();
+
+#endif
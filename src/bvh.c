@@ -0,0 +1,261 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "bvh.h"
+#include "mesh.h"
+#include "clipping.h"
+
+// What the hierarchy keeps of every mesh: its world-space bounding box, and the transform and
+// instances the box was computed for, to notice when the mesh or its instances move.
+typedef struct {
+    vector3_t boundsMin;
+    vector3_t boundsMax;
+    vector3_t position;
+    vector3_t rotation;
+    vector3_t scale;
+    int instancesRevision;
+} bvhEntry_t;
+
+static bvhEntry_t* entries = NULL;
+static int numberEntries = 0;
+static int* meshOrder = NULL;
+static bvhNode_t* nodes = NULL;
+static int numberNodes = 0;
+
+// Axis the meshes are being sorted along while building (see `compareCenters`).
+static int sortAxis = 0;
+
+static float getAxis(vector3_t vector, int axis)
+{
+    return axis == 0 ? vector.x : axis == 1 ? vector.y : vector.z;
+}
+
+static vector3_t minVector(vector3_t a, vector3_t b)
+{
+    return (vector3_t){ a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z };
+}
+
+static vector3_t maxVector(vector3_t a, vector3_t b)
+{
+    return (vector3_t){ a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z };
+}
+
+static bool isSameVector(vector3_t a, vector3_t b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// Orders mesh indices by the center of their world bounds along `sortAxis`.
+static int compareCenters(const void* a, const void* b)
+{
+    const bvhEntry_t* entryA = &entries[*(const int*)a];
+    const bvhEntry_t* entryB = &entries[*(const int*)b];
+    float centerA = getAxis(entryA->boundsMin, sortAxis) + getAxis(entryA->boundsMax, sortAxis);
+    float centerB = getAxis(entryB->boundsMin, sortAxis) + getAxis(entryB->boundsMax, sortAxis);
+
+    return (centerA > centerB) - (centerA < centerB);
+}
+
+// Computes the world bounds of mesh `index` for its current transform.
+static void fitEntry(int index)
+{
+    const mesh_t* mesh = getMesh(index);
+    bvhEntry_t* entry = &entries[index];
+    matrix4_t transformMatrix = getMeshTransformMatrix(mesh);
+
+    getMeshWorldBounds(mesh, &transformMatrix, &entry->boundsMin, &entry->boundsMax);
+
+    entry->position = mesh->position;
+    entry->rotation = mesh->rotation;
+    entry->scale = mesh->scale;
+    entry->instancesRevision = mesh->instancesRevision;
+}
+
+// Recomputes the world bounds of the meshes whose position, rotation, scale or instances
+// changed since their bounds were last computed. Returns whether any did.
+static bool updateEntries()
+{
+    bool hasChanged = false;
+
+    for (int i = 0; i < numberEntries; i++)
+    {
+        const mesh_t* mesh = getMesh(i);
+        const bvhEntry_t* entry = &entries[i];
+
+        if (isSameVector(entry->position, mesh->position)
+            && isSameVector(entry->rotation, mesh->rotation)
+            && isSameVector(entry->scale, mesh->scale)
+            && entry->instancesRevision == mesh->instancesRevision) continue;
+
+        fitEntry(i);
+        hasChanged = true;
+    }
+
+    return hasChanged;
+}
+
+// Sets a leaf's box to the union of its meshes' boxes, or an inner node's to its children's.
+static void fitNode(bvhNode_t* node)
+{
+    if (node->count > 0)
+    {
+        node->boundsMin = entries[meshOrder[node->first]].boundsMin;
+        node->boundsMax = entries[meshOrder[node->first]].boundsMax;
+
+        for (int i = 1; i < node->count; i++)
+        {
+            node->boundsMin = minVector(node->boundsMin, entries[meshOrder[node->first + i]].boundsMin);
+            node->boundsMax = maxVector(node->boundsMax, entries[meshOrder[node->first + i]].boundsMax);
+        }
+    }
+    else
+    {
+        node->boundsMin = minVector(nodes[node->first].boundsMin, nodes[node->first + 1].boundsMin);
+        node->boundsMax = maxVector(nodes[node->first].boundsMax, nodes[node->first + 1].boundsMax);
+    }
+}
+
+// Builds the subtree of node `index` over the meshes meshOrder[first] .. meshOrder[first + count - 1].
+// The node's meshes are split in two halves along the longest axis of their box, sorted by
+// the centers of their boxes, until no more than BVH_LEAF_SIZE meshes are left.
+static void buildNode(int index, int first, int count)
+{
+    bvhNode_t* node = &nodes[index];
+
+    node->first = first;
+    node->count = count;
+    fitNode(node);
+
+    if (count <= BVH_LEAF_SIZE) return;
+
+    vector3_t size = vector3Sub(node->boundsMax, node->boundsMin);
+    sortAxis = size.x > size.y && size.x > size.z ? 0 : size.y > size.z ? 1 : 2;
+    qsort(&meshOrder[first], count, sizeof(int), compareCenters);
+
+    int children = numberNodes;
+    numberNodes += 2;
+
+    node->first = children;
+    node->count = 0;
+
+    buildNode(children, first, count / 2);
+    buildNode(children + 1, first + count / 2, count - count / 2);
+}
+
+// Builds the hierarchy from scratch over all the scene's meshes.
+static void buildSceneBvh()
+{
+    numberEntries = getNumberMeshes();
+    entries = realloc(entries, sizeof(bvhEntry_t) * (numberEntries > 0 ? numberEntries : 1));
+    meshOrder = realloc(meshOrder, sizeof(int) * (numberEntries > 0 ? numberEntries : 1));
+    nodes = realloc(nodes, sizeof(bvhNode_t) * (numberEntries > 0 ? 2 * numberEntries : 1));
+    numberNodes = 0;
+
+    for (int i = 0; i < numberEntries; i++)
+    {
+        fitEntry(i);
+        meshOrder[i] = i;
+    }
+
+    if (numberEntries == 0) return;
+
+    numberNodes = 1;
+    buildNode(0, 0, numberEntries);
+}
+
+// Brings the scene's bounding volume hierarchy up to date. Called once per frame, after the
+// meshes have been moved and before they are culled.
+// The hierarchy is built the first time and whenever meshes were added. After that, only the
+// boxes of meshes whose position, rotation, scale or instances changed are recomputed, and
+// the tree is refit around them: its structure is kept, and every node's box is recomputed
+// from its children, bottom-up. Refitting is far cheaper than rebuilding, and the tree stays a good fit
+// as long as meshes do not move far from the meshes they were grouped with.
+void updateSceneBvh()
+{
+    if (getNumberMeshes() != numberEntries)
+    {
+        buildSceneBvh();
+        return;
+    }
+
+    if (!updateEntries()) return;
+
+    // Children are stored after their parent, so going backwards fits every child first.
+    for (int i = numberNodes - 1; i >= 0; i--)
+    {
+        fitNode(&nodes[i]);
+    }
+}
+
+// Finds the meshes whose world bounds touch the view frustum. Writes their indices to
+// `meshIndices`, and to `frustumTests` whether their bounds are inside the frustum or cross
+// it (a FrustumTest), both with room for every mesh. Returns how many were found.
+// The hierarchy is walked from the root, testing each node's box against the frustum planes:
+// - a node outside the frustum is skipped with everything below it, so whole groups of
+//   meshes out of sight cost a single test;
+// - a node inside the frustum has all its meshes inside, which are listed without testing;
+// - only nodes crossing the frustum are opened, so the work grows with the visible meshes
+//   (and the few groups along the frustum's sides) rather than with the size of the scene.
+int cullSceneBvh(const vector4_t* frustumPlanes, int* meshIndices, int* frustumTests)
+{
+    // Nodes still to visit, with whether an ancestor was already found inside the frustum.
+    int stack[2 * BVH_MAX_DEPTH];
+    bool isStackInside[2 * BVH_MAX_DEPTH];
+    int stackSize = 0;
+    int numberFound = 0;
+
+    if (numberNodes == 0) return 0;
+
+    stack[stackSize] = 0;
+    isStackInside[stackSize] = false;
+    stackSize++;
+
+    while (stackSize > 0)
+    {
+        stackSize--;
+        const bvhNode_t* node = &nodes[stack[stackSize]];
+        int test = isStackInside[stackSize] ? FRUSTUM_INSIDE : classifyAabb(frustumPlanes, node->boundsMin, node->boundsMax);
+
+        if (test == FRUSTUM_OUTSIDE) continue;
+
+        if (node->count == 0)
+        {
+            for (int c = 1; c >= 0; c--)
+            {
+                stack[stackSize] = node->first + c;
+                isStackInside[stackSize] = test == FRUSTUM_INSIDE;
+                stackSize++;
+            }
+
+            continue;
+        }
+
+        for (int i = 0; i < node->count; i++)
+        {
+            int meshIndex = meshOrder[node->first + i];
+            const bvhEntry_t* entry = &entries[meshIndex];
+            int meshTest = test == FRUSTUM_INSIDE ? FRUSTUM_INSIDE : classifyAabb(frustumPlanes, entry->boundsMin, entry->boundsMax);
+
+            if (meshTest == FRUSTUM_OUTSIDE) continue;
+
+            meshIndices[numberFound] = meshIndex;
+            frustumTests[numberFound] = meshTest;
+            numberFound++;
+        }
+    }
+
+    return numberFound;
+}
+
+// Frees the hierarchy. It is built again by the next `updateSceneBvh`.
+void freeSceneBvh()
+{
+    free(entries);
+    free(meshOrder);
+    free(nodes);
+
+    entries = NULL;
+    meshOrder = NULL;
+    nodes = NULL;
+    numberEntries = 0;
+    numberNodes = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef BVH
+#define BVH
+
+#include "vector.h"
+
+// Most meshes a leaf of the scene's bounding volume hierarchy holds.
+#define BVH_LEAF_SIZE 4
+
+// Deepest the hierarchy gets: a split always halves the meshes of a node, so 32 levels hold
+// billions of meshes, and culling can walk it with a fixed-size stack.
+#define BVH_MAX_DEPTH 32
+
+// A node of the bounding volume hierarchy: a world-space box around all the meshes below it.
+// The nodes are stored depth-first, so a node's children always come after it. An inner
+// node's children are nodes `first` and `first + 1`; a leaf holds the `count` meshes listed
+// from entry `first` of the hierarchy's mesh order.
+typedef struct {
+    vector3_t boundsMin;
+    vector3_t boundsMax;
+    int first;
+    int count;
+} bvhNode_t;
+
+void updateSceneBvh();
+int cullSceneBvh(const vector4_t* frustumPlanes, int* meshIndices, int* frustumTests);
+void freeSceneBvh();
+
+#endif
@@ -1,54 +1,271 @@
 #include <math.h>
 #include "clipping.h"
 #include "triangle.h"
+#include "simd.h"
 
-// Initializes the six planes of the view frustum in camera space.
-// This is part of the setup for the clipping stage. The frustum is a pyramid-like shape
-// that defines the visible volume of the scene.
+// Returns the signed distance-like value of a clip-space point to one frustum plane: not
+// negative inside the plane and negative outside. Each plane is one of the six inequalities
+// of the clip-space frustum rewritten as value >= 0 (x >= -w becomes w + x >= 0, and so on),
+// so it needs no setup at all and always matches the projection matrix the points went
+// through, whatever its field of view and aspect ratio.
+// The value is a linear function of (x, y, z, w), so along an edge it changes linearly, and
+// where it crosses zero is where the edge crosses the plane.
+static float planeDistance(const vector4_t* point, int plane)
+{
+    switch (plane)
+    {
+        case LEFT_FRUSTUM_PLANE: return point->w + point->x;
+        case RIGHT_FRUSTUM_PLANE: return point->w - point->x;
+        case TOP_FRUSTUM_PLANE: return point->w - point->y;
+        case BOTTOM_FRUSTUM_PLANE: return point->w + point->y;
+        case NEAR_FRUSTUM_PLANE: return point->z;
+        default: return point->w - point->z;
+    }
+}
+
+// Computes the outcode of a point in clip space: a bit per frustum plane, set when the
+// point is on the outer side of that plane. Points exactly on a plane are inside it.
+// Outcodes are computed once per vertex, and then classify whole triangles without any
+// further arithmetic:
+// - when the outcodes of all three vertices share a bit, the triangle is completely outside
+//   that plane and can be discarded;
+// - when all three outcodes are zero, the triangle is inside the frustum and needs no clipping;
+// - otherwise, only the planes in the union of the outcodes are crossed by the triangle.
+//
+// Math: the point is outside a plane when its `planeDistance` is negative. A point behind the
+// camera has w < 0, so it is outside the left or the right plane (w + x and w - x cannot both
+// be positive) as well as the near plane.
+int computeOutcode(vector4_t point)
+{
+    int outcode = 0;
+
+    for (int p = 0; p < FRUSTUM_NUM_PLANES; p++)
+    {
+        if (planeDistance(&point, p) < 0)
+        {
+            outcode |= 1 << p;
+        }
+    }
+
+    return outcode;
+}
+
+// Extracts the planes of the view frustum in the space that `viewProjection` maps to clip
+// space (world space for projection * view). Each plane is (a, b, c, d), with (a, b, c) a unit
+// normal pointing into the frustum, so a*x + b*y + c*z + d is the distance of the point
+// (x, y, z) to the plane: positive inside.
+// These planes test bounding volumes before their vertices are transformed at all.
+//
+// Math:
+// 1. The clip-space point of p = (x, y, z, 1) is M*p = x*M0 + y*M1 + z*M2 + M3, where Mj is
+//    column j of M, the clip-space image of the basis vector e_j.
+// 2. `planeDistance` is linear, so the distance of M*p is x*D(M0) + y*D(M1) + z*D(M2) + D(M3):
+//    the plane's coefficients are the distances of the matrix's columns.
+// 3. Dividing the four coefficients by the length of (a, b, c) makes the value a true
+//    distance without moving the plane.
+void extractFrustumPlanes(const matrix4_t* viewProjection, vector4_t* planes)
+{
+    vector4_t columns[4];
+
+    for (int j = 0; j < 4; j++)
+    {
+        columns[j] = (vector4_t){
+            viewProjection->m[0][j],
+            viewProjection->m[1][j],
+            viewProjection->m[2][j],
+            viewProjection->m[3][j]
+        };
+    }
+
+    for (int p = 0; p < FRUSTUM_NUM_PLANES; p++)
+    {
+        vector4_t plane = {
+            planeDistance(&columns[0], p),
+            planeDistance(&columns[1], p),
+            planeDistance(&columns[2], p),
+            planeDistance(&columns[3], p)
+        };
+
+        float length = vector3Magnitude(vector4to3(plane));
+
+        planes[p] = (vector4_t){ plane.x / length, plane.y / length, plane.z / length, plane.w / length };
+    }
+}
+
+// Tests a bounding sphere against the frustum planes from `extractFrustumPlanes`, returning
+// a FrustumTest. A sphere is outside as soon as its center is more than a radius outside one
+// plane, and inside when it is more than a radius inside all of them. Near the frustum's
+// corners a sphere can be outside while being reported as intersecting, which only costs
+// clipping work, never a visible object.
+int classifySphere(const vector4_t* planes, vector3_t center, float radius)
+{
+    int result = FRUSTUM_INSIDE;
+
+    for (int p = 0; p < FRUSTUM_NUM_PLANES; p++)
+    {
+        float distance = planes[p].x * center.x + planes[p].y * center.y + planes[p].z * center.z + planes[p].w;
+
+        if (distance < -radius) return FRUSTUM_OUTSIDE;
+        if (distance < radius) result = FRUSTUM_INTERSECTS;
+    }
+
+    return result;
+}
+
+#if SIMD_LANES > 1
+// Lists the spheres first .. first + SIMD_LANES - 1 that are not outside: `visibleMask` has a
+// bit set per sphere not outside any plane, and `crossingMask` per sphere crossing one.
+static inline void appendSpheres(int first, int visibleMask, int crossingMask, int* indices, int* frustumTests, int* numberFound)
+{
+    while (visibleMask != 0)
+    {
+        int lane = __builtin_ctz(visibleMask);
+
+        indices[*numberFound] = first + lane;
+        frustumTests[*numberFound] = (crossingMask >> lane) & 1 ? FRUSTUM_INTERSECTS : FRUSTUM_INSIDE;
+        (*numberFound)++;
+
+        visibleMask &= visibleMask - 1;
+    }
+}
+#endif
+
+// Tests `count` bounding spheres against frustum planes made by `extractFrustumPlanes`, like
+// `classifySphere`. The spheres are given as separate arrays of center coordinates and radii,
+// so SIMD_LANES of them are loaded and tested against a plane with a few vector instructions.
+// Writes the indices of the spheres that are not outside to `indices`, and their FrustumTest
+// to `frustumTests`, both with room for `count` spheres. Returns how many there are.
+int cullSpheres(
+    const vector4_t* planes,
+    const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+    int count, int* indices, int* frustumTests
+)
+{
+    int numberFound = 0;
+    int first = 0;
+
+#if SIMD_LANES == 8
+    for (; first + SIMD_LANES <= count; first += SIMD_LANES)
+    {
+        __m256 x = _mm256_loadu_ps(&centerX[first]);
+        __m256 y = _mm256_loadu_ps(&centerY[first]);
+        __m256 z = _mm256_loadu_ps(&centerZ[first]);
+        __m256 r = _mm256_loadu_ps(&radius[first]);
+        __m256 negativeR = _mm256_sub_ps(_mm256_setzero_ps(), r);
+        __m256 outside = _mm256_setzero_ps();
+        __m256 crossing = _mm256_setzero_ps();
+
+        for (int p = 0; p < FRUSTUM_NUM_PLANES; p++)
+        {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[p].x), x), _mm256_mul_ps(_mm256_set1_ps(planes[p].y), y)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[p].z), z), _mm256_set1_ps(planes[p].w))
+            );
+
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negativeR, _CMP_LT_OQ));
+            crossing = _mm256_or_ps(crossing, _mm256_cmp_ps(distance, r, _CMP_LT_OQ));
+        }
+
+        int visibleMask = ~_mm256_movemask_ps(outside) & 0xFF;
+        appendSpheres(first, visibleMask, _mm256_movemask_ps(crossing), indices, frustumTests, &numberFound);
+    }
+#elif SIMD_LANES == 4
+    for (; first + SIMD_LANES <= count; first += SIMD_LANES)
+    {
+        __m128 x = _mm_loadu_ps(&centerX[first]);
+        __m128 y = _mm_loadu_ps(&centerY[first]);
+        __m128 z = _mm_loadu_ps(&centerZ[first]);
+        __m128 r = _mm_loadu_ps(&radius[first]);
+        __m128 negativeR = _mm_sub_ps(_mm_setzero_ps(), r);
+        __m128 outside = _mm_setzero_ps();
+        __m128 crossing = _mm_setzero_ps();
+
+        for (int p = 0; p < FRUSTUM_NUM_PLANES; p++)
+        {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].x), x), _mm_mul_ps(_mm_set1_ps(planes[p].y), y)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].z), z), _mm_set1_ps(planes[p].w))
+            );
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeR));
+            crossing = _mm_or_ps(crossing, _mm_cmplt_ps(distance, r));
+        }
+
+        int visibleMask = ~_mm_movemask_ps(outside) & 0xF;
+        appendSpheres(first, visibleMask, _mm_movemask_ps(crossing), indices, frustumTests, &numberFound);
+    }
+#endif
+
+    // The spheres left over after the last full group of lanes (or all of them without SIMD).
+    for (; first < count; first++)
+    {
+        vector3_t center = { centerX[first], centerY[first], centerZ[first] };
+        int test = classifySphere(planes, center, radius[first]);
+
+        if (test == FRUSTUM_OUTSIDE) continue;
+
+        indices[numberFound] = first;
+        frustumTests[numberFound] = test;
+        numberFound++;
+    }
+
+    return numberFound;
+}
+
+// Tests an axis-aligned box against the frustum planes from `extractFrustumPlanes`, returning
+// a FrustumTest. Like `classifySphere`, it may report a box near the frustum's corners as
+// intersecting when it is outside, but never the other way round.
 //
-// The math involves using the horizontal (fovX) and vertical (fovY) fields of view to
-// calculate the normal vectors for the left, right, top, and bottom planes. These normals
-// are calculated using sine and cosine of half the FOV angles to define planes that pass
-// through the origin (the camera's position) and are angled correctly. The near and far
-// planes are simpler, being parallel to the XY plane at zNear and zFar respectively.
-// All normals point *inside* the frustum volume.
-void initFrustumPlane(plane_t* frustumPlanes, float fovX, float fovY, float zNear, float zFar)
+// Math: the box's corners are its center c plus or minus its half-extents e on each axis. The
+// corner farthest along a plane's normal n is at a distance of dot(c, n) + d + r from it, and
+// the nearest at dot(c, n) + d - r, with r = e.x * |n.x| + e.y * |n.y| + e.z * |n.z|.
+int classifyAabb(const vector4_t* planes, vector3_t boxMin, vector3_t boxMax)
+{
+    vector3_t center = { (boxMin.x + boxMax.x) / 2, (boxMin.y + boxMax.y) / 2, (boxMin.z + boxMax.z) / 2 };
+    vector3_t extent = { (boxMax.x - boxMin.x) / 2, (boxMax.y - boxMin.y) / 2, (boxMax.z - boxMin.z) / 2 };
+    int result = FRUSTUM_INSIDE;
+
+    for (int p = 0; p < FRUSTUM_NUM_PLANES; p++)
+    {
+        float distance = planes[p].x * center.x + planes[p].y * center.y + planes[p].z * center.z + planes[p].w;
+        float radius = extent.x * fabsf(planes[p].x) + extent.y * fabsf(planes[p].y) + extent.z * fabsf(planes[p].z);
+
+        if (distance < -radius) return FRUSTUM_OUTSIDE;
+        if (distance < radius) result = FRUSTUM_INTERSECTS;
+    }
+
+    return result;
+}
+
+// Tests a bounding box against the frustum, returning a FrustumTest. The eight corners are
+// transformed into clip space by `clipMatrix` and classified with outcodes, exactly like the
+// vertices of a triangle: the box is outside when all its corners are outside the same plane,
+// and inside when no corner is outside any plane (the frustum is convex, so then everything
+// between the corners is inside too).
+int classifyBox(const matrix4_t* clipMatrix, vector3_t boxMin, vector3_t boxMax)
 {
-    float cosHalfFovX = cos(fovX / 2);
-    float sinHalfFovX = sin(fovX / 2);
-
-    float cosHalfFovY = cos(fovY / 2);
-    float sinHalfFovY = sin(fovY / 2);
-
-    frustumPlanes[LEFT_FRUSTUM_PLANE].point = (vector3_t){ 0, 0, 0 };
-    frustumPlanes[LEFT_FRUSTUM_PLANE].normal.x = cosHalfFovX;
-    frustumPlanes[LEFT_FRUSTUM_PLANE].normal.y = 0;
-    frustumPlanes[LEFT_FRUSTUM_PLANE].normal.z = sinHalfFovX;
-
-    frustumPlanes[RIGHT_FRUSTUM_PLANE].point = (vector3_t){ 0, 0, 0 };
-    frustumPlanes[RIGHT_FRUSTUM_PLANE].normal.x = -cosHalfFovX;
-    frustumPlanes[RIGHT_FRUSTUM_PLANE].normal.y = 0;
-    frustumPlanes[RIGHT_FRUSTUM_PLANE].normal.z = sinHalfFovX;
-
-    frustumPlanes[TOP_FRUSTUM_PLANE].point = (vector3_t){ 0, 0, 0 };
-    frustumPlanes[TOP_FRUSTUM_PLANE].normal.x = 0;
-    frustumPlanes[TOP_FRUSTUM_PLANE].normal.y = -cosHalfFovY;
-    frustumPlanes[TOP_FRUSTUM_PLANE].normal.z = sinHalfFovY;
-
-    frustumPlanes[BOTTOM_FRUSTUM_PLANE].point = (vector3_t){ 0, 0, 0 };
-    frustumPlanes[BOTTOM_FRUSTUM_PLANE].normal.x = 0;
-    frustumPlanes[BOTTOM_FRUSTUM_PLANE].normal.y = cosHalfFovY;
-    frustumPlanes[BOTTOM_FRUSTUM_PLANE].normal.z = sinHalfFovY;
-
-    frustumPlanes[NEAR_FRUSTUM_PLANE].point = (vector3_t){ 0, 0, zNear };
-    frustumPlanes[NEAR_FRUSTUM_PLANE].normal.x = 0;
-    frustumPlanes[NEAR_FRUSTUM_PLANE].normal.y = 0;
-    frustumPlanes[NEAR_FRUSTUM_PLANE].normal.z = 1;
-
-    frustumPlanes[FAR_FRUSTUM_PLANE].point = (vector3_t){ 0, 0, zFar };
-    frustumPlanes[FAR_FRUSTUM_PLANE].normal.x = 0;
-    frustumPlanes[FAR_FRUSTUM_PLANE].normal.y = 0;
-    frustumPlanes[FAR_FRUSTUM_PLANE].normal.z = -1;
+    int commonOutcode = ~0;
+    int anyOutcode = 0;
+
+    for (int c = 0; c < 8; c++)
+    {
+        vector4_t corner = {
+            c & 1 ? boxMax.x : boxMin.x,
+            c & 2 ? boxMax.y : boxMin.y,
+            c & 4 ? boxMax.z : boxMin.z,
+            1
+        };
+
+        int outcode = computeOutcode(matrix4MultiplyVector4(clipMatrix, &corner));
+
+        commonOutcode &= outcode;
+        anyOutcode |= outcode;
+    }
+
+    if (commonOutcode) return FRUSTUM_OUTSIDE;
+    if (anyOutcode) return FRUSTUM_INTERSECTS;
+
+    return FRUSTUM_INSIDE;
 }
 
 // Converts a triangle into a polygon structure.
@@ -56,7 +273,7 @@ void initFrustumPlane(plane_t* frustumPlanes, float fovX, float fovY, float zNea
 // structure is more flexible than a triangle, as the number of vertices can change
 // during the clipping process.
 polygon_t createPolygonFromTriangle(
-    vector3_t v0, vector3_t v1, vector3_t v2,
+    vector4_t v0, vector4_t v1, vector4_t v2,
     texture_t uv0, texture_t uv1, texture_t uv2)
 {
     polygon_t polygon = {
@@ -82,40 +299,42 @@ float floatLerp(float a, float b, float t) {
 //
 // For each edge (from a previous to a current vertex):
 // 1. It determines if the vertices are inside or outside the plane by checking the sign
-//    of the dot product between the vector from the plane's point to the vertex and the
-//    plane's normal. A positive dot product means the vertex is inside.
+//    of their `planeDistance`. A distance that is not negative means the vertex is inside,
+//    as in `computeOutcode`.
 // 2. If an edge crosses the plane boundary, it calculates the intersection point. The
-//    interpolation factor 't' is found using the dot products: t = prev_dot / (prev_dot - current_dot).
-// 3. This 't' value is used to linearly interpolate the vertex position and UV coordinates
-//    to find the new vertex at the intersection.
+//    interpolation factor 't' is found using the distances: t = prev_distance / (prev_distance - current_distance).
+// 3. This 't' value is used to linearly interpolate the vertex position (all four clip-space
+//    components) and UV coordinates to find the new vertex at the intersection. Clip space
+//    comes before the perspective division, so interpolating linearly there is exact.
 // 4. A new list of "inside" vertices is generated, forming the clipped polygon.
-void clipPolygonAgainstPlane(polygon_t* polygon, const plane_t* plane)
+void clipPolygonAgainstPlane(polygon_t* polygon, int plane)
 {
-    vector3_t insideVertices[MAX_NUM_POLY_VERTICES];
+    vector4_t insideVertices[MAX_NUM_POLY_VERTICES];
     texture_t insideUVs[MAX_NUM_POLY_VERTICES];
     int numInsideVertices = 0;
 
-    vector3_t* currentVertex = &polygon->vertices[0];
-    vector3_t* previousVertex = &polygon->vertices[polygon->numVertices - 1];
+    vector4_t* currentVertex = &polygon->vertices[0];
+    vector4_t* previousVertex = &polygon->vertices[polygon->numVertices - 1];
 
     texture_t* currentUV = &polygon->uvCoords[0];
     texture_t* previousUV = &polygon->uvCoords[polygon->numVertices - 1];
 
-    float currentDot = 0;
-    float previousDot = vector3DotProduct(vector3Sub(*previousVertex, plane->point), plane->normal);
+    float currentDistance = 0;
+    float previousDistance = planeDistance(previousVertex, plane);
 
     while (currentVertex != &polygon->vertices[polygon->numVertices]) {
-        currentDot = vector3DotProduct(vector3Sub(*currentVertex, plane->point), plane->normal);
+        currentDistance = planeDistance(currentVertex, plane);
 
         // If we changed from inside to outside or from outside to inside
-        if (currentDot * previousDot < 0) {
+        if (currentDistance * previousDistance < 0) {
             // Find the interpolation factor t
-            float t = previousDot / (previousDot - currentDot);
+            float t = previousDistance / (previousDistance - currentDistance);
 
-            vector3_t intersectionPoint = (vector3_t){
+            vector4_t intersectionPoint = (vector4_t){
                 .x = floatLerp(previousVertex->x, currentVertex->x, t),
                 .y = floatLerp(previousVertex->y, currentVertex->y, t),
-                .z = floatLerp(previousVertex->z, currentVertex->z, t)
+                .z = floatLerp(previousVertex->z, currentVertex->z, t),
+                .w = floatLerp(previousVertex->w, currentVertex->w, t)
             };
 
             texture_t intersectionUV = (texture_t){
@@ -123,19 +342,19 @@ void clipPolygonAgainstPlane(polygon_t* polygon, const plane_t* plane)
                 .v = floatLerp(previousUV->v, currentUV->v, t)
             };
 
-            insideVertices[numInsideVertices] = vector3Clone(intersectionPoint);
+            insideVertices[numInsideVertices] = intersectionPoint;
             insideUVs[numInsideVertices] = intersectionUV;
             numInsideVertices++;
         }
 
         // Current vertex is inside the plane
-        if (currentDot > 0) {
-            insideVertices[numInsideVertices] = vector3Clone(*currentVertex);
+        if (currentDistance >= 0) {
+            insideVertices[numInsideVertices] = *currentVertex;
             insideUVs[numInsideVertices] = (texture_t){ .u = currentUV->u, .v = currentUV->v };
             numInsideVertices++;
         }
 
-        previousDot = currentDot;
+        previousDistance = currentDistance;
         previousVertex = currentVertex;
         currentVertex++;
 
@@ -144,26 +363,25 @@ void clipPolygonAgainstPlane(polygon_t* polygon, const plane_t* plane)
     }
     
     for (int i = 0; i < numInsideVertices; i++) {
-        polygon->vertices[i] = vector3Clone(insideVertices[i]);
+        polygon->vertices[i] = insideVertices[i];
         polygon->uvCoords[i] = insideUVs[i];
     }
 
     polygon->numVertices = numInsideVertices;
 }
 
-// Clips a polygon against all six planes of the view frustum.
+// Clips a polygon against the planes of the view frustum in `planeMask`.
 // This function orchestrates the clipping process by calling `clipPolygonAgainstPlane`
-// sequentially for each of the six frustum planes. The output polygon from one clipping
-// stage becomes the input for the next. If the polygon is ever reduced to fewer than
-// three vertices, it is effectively discarded.
-void clipPolygon(polygon_t* polygon, const plane_t* frustumPlanes)
+// sequentially for each plane in the mask: the union of the outcodes of the polygon's
+// vertices, so planes that no vertex is outside of are never visited. The output polygon
+// from one clipping stage becomes the input for the next. If the polygon is ever reduced to
+// fewer than three vertices, it is effectively discarded.
+void clipPolygon(polygon_t* polygon, int planeMask)
 {
-    clipPolygonAgainstPlane(polygon, &frustumPlanes[LEFT_FRUSTUM_PLANE]);
-    clipPolygonAgainstPlane(polygon, &frustumPlanes[RIGHT_FRUSTUM_PLANE]);
-    clipPolygonAgainstPlane(polygon, &frustumPlanes[TOP_FRUSTUM_PLANE]);
-    clipPolygonAgainstPlane(polygon, &frustumPlanes[BOTTOM_FRUSTUM_PLANE]);
-    clipPolygonAgainstPlane(polygon, &frustumPlanes[NEAR_FRUSTUM_PLANE]);
-    clipPolygonAgainstPlane(polygon, &frustumPlanes[FAR_FRUSTUM_PLANE]);
+    for (int p = 0; p < FRUSTUM_NUM_PLANES && polygon->numVertices >= 3; p++)
+    {
+        if (planeMask & (1 << p)) clipPolygonAgainstPlane(polygon, p);
+    }
 }
 
 // Converts a final (clipped) polygon back into one or more triangles.
@@ -172,6 +390,7 @@ void clipPolygon(polygon_t* polygon, const plane_t* frustumPlanes)
 // "triangle fan" method, where the first vertex of the polygon is used as a common
 // vertex for all the new triangles.
 //
+// The triangles keep the clip-space vertices of the polygon, still to be projected.
 // For a polygon with N vertices, it creates (N - 2) triangles.
 // Triangle 1: (v0, v1, v2)
 // Triangle 2: (v0, v2, v3)
@@ -184,9 +403,9 @@ void trianglesFromPolygon(const polygon_t* polygon, triangle_t* triangles, int*
         int index1 = i + 1;
         int index2 = i + 2;
 
-        triangles[i].points[0] = vector3to4(polygon->vertices[index0]);
-        triangles[i].points[1] = vector3to4(polygon->vertices[index1]);
-        triangles[i].points[2] = vector3to4(polygon->vertices[index2]);
+        triangles[i].points[0] = polygon->vertices[index0];
+        triangles[i].points[1] = polygon->vertices[index1];
+        triangles[i].points[2] = polygon->vertices[index2];
 
         triangles[i].textureCoordinates[0] = polygon->uvCoords[index0];
         triangles[i].textureCoordinates[1] = polygon->uvCoords[index1];
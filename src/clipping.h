@@ -2,13 +2,23 @@
 #define CLIPPING
 
 #include "vector.h"
-#include "triangle.h"
+#include "matrix.h"
 #include "triangle.h"
 
 #define FRUSTUM_NUM_PLANES 6
 #define MAX_NUM_POLY_VERTICES 10
 #define MAX_NUM_POLY_TRIANGLES 10
 
+// Pixels the guard band extends past the window edges. Triangles with every vertex in front
+// of the near plane and inside the guard band are not clipped: the rasterizer only visits the
+// part of their bounding box inside the window. It works on integer pixel coordinates, and
+// twice the area of a triangle must fit in an int, so the guard band and the window together
+// must stay well under 32768 pixels across.
+#define GUARD_BAND_SIZE 8192
+
+// The six planes of the view frustum, in homogeneous clip space (the camera-space point
+// multiplied by the projection matrix, before the division by w). A point is inside the
+// frustum when -w <= x <= w, -w <= y <= w and 0 <= z <= w.
 enum {
     LEFT_FRUSTUM_PLANE,
     RIGHT_FRUSTUM_PLANE,
@@ -18,30 +28,51 @@ enum {
     FAR_FRUSTUM_PLANE
 };
 
-// Represents a plane in 3D space, defined by a point on the plane and a normal vector.
-// Used to define the six planes of the view frustum for clipping. The normal vector
-// is expected to point "inward", into the visible volume of the frustum.
-typedef struct {
-    vector3_t point;
-    vector3_t normal;
-} plane_t;
+// Outcodes: bit p of a point's outcode (1 << p) is set when the point is outside frustum
+// plane p. Outcodes of the near and far planes, which the guard band cannot absorb.
+#define OUTCODE_NEAR_FAR ((1 << NEAR_FRUSTUM_PLANE) | (1 << FAR_FRUSTUM_PLANE))
+
+// Where a bounding volume lies relative to the view frustum.
+enum FrustumTest
+{
+    // Completely outside one of the planes: nothing inside the volume can be visible.
+    FRUSTUM_OUTSIDE,
+    // Crossing one or more planes: what is inside the volume needs per-triangle clipping.
+    FRUSTUM_INTERSECTS,
+    // Completely inside every plane: nothing inside the volume needs clipping.
+    FRUSTUM_INSIDE
+};
 
 // Represents a polygon, used as an intermediate format during clipping.
 // A triangle is first converted to a polygon. As it's clipped against the frustum
 // planes, it can gain or lose vertices. After clipping is complete, the resulting
-// polygon is triangulated back into one or more triangles.
+// polygon is triangulated back into one or more triangles. The vertices are in clip space.
 typedef struct {
-    vector3_t vertices[MAX_NUM_POLY_VERTICES];
+    vector4_t vertices[MAX_NUM_POLY_VERTICES];
     texture_t uvCoords[MAX_NUM_POLY_VERTICES];
     int numVertices;
 } polygon_t;
 
-// Initializes the six planes of the view frustum in camera space.
-void initFrustumPlane(plane_t* frustumPlanes, float fovX, float fovY, float zNear, float zFar);
+// Returns the outcode of a clip-space point: which frustum planes it is outside of.
+int computeOutcode(vector4_t point);
+// Extracts the six frustum planes of a view-projection matrix, as (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside.
+void extractFrustumPlanes(const matrix4_t* viewProjection, vector4_t* planes);
+// Tests a sphere against frustum planes made by `extractFrustumPlanes`.
+int classifySphere(const vector4_t* planes, vector3_t center, float radius);
+// Tests many spheres, stored as arrays of center coordinates and radii, against frustum planes made by `extractFrustumPlanes`.
+int cullSpheres(
+    const vector4_t* planes,
+    const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+    int count, int* indices, int* frustumTests
+);
+// Tests an axis-aligned box against frustum planes made by `extractFrustumPlanes`.
+int classifyAabb(const vector4_t* planes, vector3_t boxMin, vector3_t boxMax);
+// Tests a box against the frustum, in the clip space of `clipMatrix` (projection * view * model).
+int classifyBox(const matrix4_t* clipMatrix, vector3_t boxMin, vector3_t boxMax);
 // Converts a triangle into a polygon to begin the clipping process.
-polygon_t createPolygonFromTriangle(vector3_t v0, vector3_t v1, vector3_t v2, texture_t uv0, texture_t uv1, texture_t uv2);
-// Clips a polygon against the six planes of the view frustum using the Sutherland-Hodgman algorithm.
-void clipPolygon(polygon_t* polygon, const plane_t* frustumPlanes);
+polygon_t createPolygonFromTriangle(vector4_t v0, vector4_t v1, vector4_t v2, texture_t uv0, texture_t uv1, texture_t uv2);
+// Clips a polygon against the frustum planes in `planeMask` (an outcode) using the Sutherland-Hodgman algorithm.
+void clipPolygon(polygon_t* polygon, int planeMask);
 // Converts a clipped polygon back into one or more triangles that can be rendered.
 void trianglesFromPolygon(const polygon_t* polygon, triangle_t* triangles, int* numberTriangles);
 
@@ -0,0 +1,69 @@
+#include <SDL2/SDL.h>
+#include "color.h"
+
+// The display's pixel format, and the bit position of each 8-bit channel in it.
+// RGBA8888 is both the default and the format the engine's colors are written in.
+static uint32_t colorFormat = SDL_PIXELFORMAT_RGBA8888;
+static int redShift = 24;
+static int greenShift = 16;
+static int blueShift = 8;
+static int alphaShift = 0;
+
+// Returns the bit position of the lowest set bit of a channel mask.
+static int maskShift(Uint32 mask)
+{
+    int shift = 0;
+
+    while (mask != 0 && (mask & 1) == 0)
+    {
+        mask >>= 1;
+        shift++;
+    }
+
+    return shift;
+}
+
+// Selects the format colors are mapped to. Only 32-bit formats with 8 bits per channel are
+// accepted (e.g. ARGB8888, ABGR8888, RGB888); for any other format the colors stay RGBA8888.
+// A format without alpha gets its alpha written into the unused byte, which the display ignores.
+void setColorFormat(uint32_t pixelFormat)
+{
+    int bitsPerPixel;
+    Uint32 red, green, blue, alpha;
+
+    if (!SDL_PixelFormatEnumToMasks(pixelFormat, &bitsPerPixel, &red, &green, &blue, &alpha)) return;
+    if (bitsPerPixel != 32 && bitsPerPixel != 24) return;
+    if (SDL_BYTESPERPIXEL(pixelFormat) != 4) return;
+    if ((red >> maskShift(red)) != 0xFF || (green >> maskShift(green)) != 0xFF || (blue >> maskShift(blue)) != 0xFF) return;
+
+    colorFormat = pixelFormat;
+    redShift = maskShift(red);
+    greenShift = maskShift(green);
+    blueShift = maskShift(blue);
+    // The alpha byte is the one left over by the three color channels.
+    alphaShift = alpha != 0 ? maskShift(alpha) : 48 - redShift - greenShift - blueShift;
+}
+
+// Returns the pixel format colors are mapped to.
+uint32_t getColorFormat()
+{
+    return colorFormat;
+}
+
+// Maps an RGBA8888 color to the display's format by moving each channel to its byte.
+uint32_t mapColor(uint32_t color)
+{
+    return ((color >> 24) & 0xFF) << redShift
+        | ((color >> 16) & 0xFF) << greenShift
+        | ((color >> 8) & 0xFF) << blueShift
+        | (color & 0xFF) << alphaShift;
+}
+
+// Maps an array of RGBA8888 colors (e.g. a texture's texels) to the display's format, in place.
+void mapColors(uint32_t* colors, int numberColors)
+{
+    for (int i = 0; i < numberColors; i++)
+    {
+        colors[i] = mapColor(colors[i]);
+    }
+}
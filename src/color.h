@@ -0,0 +1,15 @@
+#ifndef COLOR
+#define COLOR
+
+#include <stdint.h>
+
+// Colors throughout the engine (light, constants, texture texels) are written as RGBA8888:
+// 0xRRGGBBAA. The color buffer holds them in the display's own 32-bit format instead, so
+// every color is mapped once on its way into the renderer and presenting a frame needs
+// no conversion.
+void setColorFormat(uint32_t pixelFormat);
+uint32_t getColorFormat();
+uint32_t mapColor(uint32_t color);
+void mapColors(uint32_t* colors, int numberColors);
+
+#endif
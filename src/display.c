@@ -2,26 +2,95 @@
 #include "display.h"
 #include "vector.h"
 #include "texture.h"
+#include "rasterizer.h"
+#include "stats.h"
+#include "color.h"
 
 static SDL_Window* window = NULL;
 static SDL_Renderer* renderer = NULL;
 static SDL_Texture* colorBufferTexture = NULL;
 
-static const int windowWidth = 800;
-static const int windowHeight = 600;
+static int windowWidth = 800;
+static int windowHeight = 600;
 
+// The color buffer is written in the display's native pixel format (see color.h). While a
+// frame is drawn in zero-copy mode it points straight at the memory of the locked streaming
+// texture, whose rows are `colorPitch` pixels apart; otherwise it points at
+// `ownedColorBuffer`, which is copied into the texture when the frame is presented.
 static uint32_t* colorBuffer = NULL;
-static float* depthBuffer = NULL;
+static uint32_t* ownedColorBuffer = NULL;
+static int colorPitch = 0;
+static bool isZeroCopyPresent = true;
+static bool isColorBufferLocked = false;
+
+static int displayBackend = DISPLAY_BACKEND_WINDOW;
+static frameCallbackFunction frameCallback = NULL;
+static void* frameCallbackData = NULL;
+
+// The depth buffer holds floats or 16-bit integers, depending on its format (see
+// `DepthFormat`). The 16-bit format maps depths between the near plane and infinity.
+static void* depthBuffer = NULL;
+static int depthFormat = DEPTH_FORMAT_FLOAT;
+static float depthNear = 1;
+
+// Visibility buffer: the index of the triangle visible at each pixel, and the prepared
+// triangles those indices refer to.
+static uint32_t* idBuffer = NULL;
+static triangleSetup_t* visibilitySetups = NULL;
+static int visibilitySetupsCapacity = 0;
+
+// Hierarchical depth buffer: a conservative [min, max] depth range per block of pixels.
+static float* blockMinDepth = NULL;
+static float* blockMaxDepth = NULL;
+static int blocksPerRow = 0;
+static int blocksPerColumn = 0;
 
 static int renderMode;
 static int cullingMode;
 
+// The region of the framebuffer the drawing functions are allowed to touch (inclusive).
+// It is thread-local so every render thread can restrict itself to the tile it owns;
+// a thread that never sets one draws to the whole window.
+static _Thread_local bool hasClipRect = false;
+static _Thread_local rect_t clipRect;
+
+// Returns the current thread's clip rectangle, already intersected with the window.
+static rect_t getClipRect()
+{
+    if (hasClipRect) return clipRect;
+
+    return (rect_t){ 0, 0, windowWidth - 1, windowHeight - 1 };
+}
+
+// Allocates the software buffers the rasterizer draws into, sized to the window.
+static void allocateBuffers()
+{
+    ownedColorBuffer = malloc(sizeof(uint32_t) * windowWidth * windowHeight);
+    colorBuffer = ownedColorBuffer;
+    colorPitch = windowWidth;
+    depthBuffer = malloc((depthFormat == DEPTH_FORMAT_UNORM16 ? sizeof(uint16_t) : sizeof(float)) * windowWidth * windowHeight);
+    idBuffer = malloc(sizeof(uint32_t) * windowWidth * windowHeight);
+
+    blocksPerRow = (windowWidth + DEPTH_BLOCK_SIZE - 1) / DEPTH_BLOCK_SIZE;
+    blocksPerColumn = (windowHeight + DEPTH_BLOCK_SIZE - 1) / DEPTH_BLOCK_SIZE;
+    blockMinDepth = malloc(sizeof(float) * blocksPerRow * blocksPerColumn);
+    blockMaxDepth = malloc(sizeof(float) * blocksPerRow * blocksPerColumn);
+}
+
 // Initializes the SDL window, renderer, and software buffers.
 // This is the entry point for the display system, setting up the main window where all
 // rendering will be presented. It also allocates memory for the color and depth buffers,
 // which are the core components of the software rasterizer.
+// With the headless backend only the buffers are allocated; SDL video is never initialized,
+// and colors stay in RGBA8888.
 void initializeWindow(bool* isRunning)
 {
+    if (displayBackend == DISPLAY_BACKEND_HEADLESS) {
+        allocateBuffers();
+        *isRunning = true;
+        return;
+    }
+
     if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
         *isRunning = false;
         return;
@@ -47,15 +116,18 @@ void initializeWindow(bool* isRunning)
         return;
     }
 
+    // Drawing in the window's own pixel format lets SDL present the texture without
+    // converting (swizzling) every pixel.
+    setColorFormat(SDL_GetWindowPixelFormat(window));
+
     colorBufferTexture = SDL_CreateTexture(
         renderer,
-        SDL_PIXELFORMAT_RGBA8888,
+        getColorFormat(),
         SDL_TEXTUREACCESS_STREAMING,
         windowWidth,
         windowHeight);
 
-    colorBuffer = malloc(sizeof(uint32_t) * windowWidth * windowHeight);
-    depthBuffer = malloc(sizeof(float) * windowWidth * windowHeight);
+    allocateBuffers();
 
     *isRunning = true;
 }
@@ -65,13 +137,65 @@ void initializeWindow(bool* isRunning)
 // by the color and depth buffers and to properly close the SDL window and renderer,
 // preventing memory leaks.
 void destroyWindow() {
-    free(colorBuffer);
+    free(ownedColorBuffer);
     free(depthBuffer);
+    free(idBuffer);
+    free(visibilitySetups);
+    free(blockMinDepth);
+    free(blockMaxDepth);
+
+    if (displayBackend == DISPLAY_BACKEND_HEADLESS) return;
+
+    SDL_DestroyTexture(colorBufferTexture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
+// Sets the size of the window (and of every buffer), in pixels.
+// Must be called before `initializeWindow`.
+void setWindowSize(int width, int height)
+{
+    windowWidth = width;
+    windowHeight = height;
+}
+
+// Chooses how frames are presented: drawn straight into the locked streaming texture
+// (zero-copy, the default), or drawn into a buffer of our own that is then copied into it.
+// Must be called before `initializeWindow`.
+void setZeroCopyPresent(bool isZeroCopy)
+{
+    isZeroCopyPresent = isZeroCopy;
+}
+
+// Selects the display backend (see `DisplayBackend`). Must be called before `initializeWindow`.
+void setDisplayBackend(int backend)
+{
+    displayBackend = backend;
+}
+
+// Returns the display backend in use.
+int getDisplayBackend()
+{
+    return displayBackend;
+}
+
+// Sets the function every finished frame is handed to by `renderColorBuffer`, with any
+// data it needs, or NULL to stop. This is how a headless frame leaves the renderer.
+void setFrameCallback(frameCallbackFunction callback, void* userData)
+{
+    frameCallback = callback;
+    frameCallbackData = userData;
+}
+
+// Selects the format of the depth buffer, and the distance of the near plane the 16-bit
+// format measures depths from. Must be called before `initializeWindow`.
+void setDepthFormat(int format, float zNear)
+{
+    depthFormat = format;
+    depthNear = zNear;
+}
+
 // Returns the width of the main application window.
 // A utility function to provide the window's width to other parts of the engine,
 // such as the projection matrix calculation and viewport transformation.
@@ -88,27 +212,109 @@ int getWindowHeight()
     return windowHeight;
 }
 
+// Describes the color, depth, visibility and hierarchical depth buffers for the rasterizer.
+static framebuffer_t getFramebuffer()
+{
+    return (framebuffer_t){
+        .colorBuffer = colorBuffer,
+        .colorPitch = colorPitch,
+        .depthBuffer = depthBuffer,
+        .depthFormat = depthFormat,
+        .depthNear = depthNear,
+        .idBuffer = idBuffer,
+        .width = windowWidth,
+        .height = windowHeight,
+        .blockMinDepth = blockMinDepth,
+        .blockMaxDepth = blockMaxDepth,
+        .blocksPerRow = blocksPerRow
+    };
+}
+
+// Restricts all drawing functions called from the current thread to a rectangle.
+// The tile renderer uses this to give each worker thread exclusive ownership of a
+// region of the color and depth buffers. The rectangle is clamped to the window.
+void setClipRect(int x, int y, int width, int height)
+{
+    clipRect.minX = x > 0 ? x : 0;
+    clipRect.minY = y > 0 ? y : 0;
+    clipRect.maxX = x + width - 1 < windowWidth - 1 ? x + width - 1 : windowWidth - 1;
+    clipRect.maxY = y + height - 1 < windowHeight - 1 ? y + height - 1 : windowHeight - 1;
+    hasClipRect = true;
+}
+
+// Removes the current thread's clip rectangle, so drawing covers the whole window again.
+void resetClipRect()
+{
+    hasClipRect = false;
+}
+
 // Clears the color buffer to a specified color.
 // This is called at the beginning of each frame's render loop to reset the canvas
-// to a solid background color before any new geometry is drawn.
+// to a solid background color before any new geometry is drawn. Only the pixels inside
+// the current clip rectangle are cleared.
 void clearColorBuffer(uint32_t color)
 {
-    for (size_t i = 0; i < windowWidth * windowHeight; i++)
+    rect_t clip = getClipRect();
+    color = mapColor(color);
+
+    for (int y = clip.minY; y <= clip.maxY; y++)
     {
-        colorBuffer[i] = color;
+        for (int x = clip.minX; x <= clip.maxX; x++)
+        {
+            colorBuffer[y * colorPitch + x] = color;
+        }
     }
 }
 
+// Points the color buffer at the streaming texture's memory for the frame about to be drawn,
+// so the rasterizer writes its pixels where SDL presents them from. Called before any
+// drawing of a frame. When zero-copy presentation is disabled, or the texture cannot be
+// locked, the frame is drawn into our own buffer and copied by `renderColorBuffer` instead.
+// The locked memory holds undefined contents, so every pixel must be written (each tile
+// starts by clearing its rectangle).
+void lockColorBuffer()
+{
+    void* pixels;
+    int pitch;
+
+    if (displayBackend == DISPLAY_BACKEND_HEADLESS || !isZeroCopyPresent || isColorBufferLocked) return;
+    if (SDL_LockTexture(colorBufferTexture, NULL, &pixels, &pitch) != 0) return;
+
+    colorBuffer = pixels;
+    colorPitch = pitch / sizeof(uint32_t);
+    isColorBufferLocked = true;
+}
+
 // Copies the contents of the software color buffer to the screen.
 // After all drawing for a frame is complete, this function uses SDL to update the
 // screen with the final image stored in the `colorBuffer`, making the rendered frame visible.
+// A frame drawn into the locked texture only needs to be unlocked; no pixel is copied.
+// The frame is handed to the frame callback first, if one is set; with the headless backend
+// that is all presenting does.
 void renderColorBuffer()
 {
-    SDL_UpdateTexture(
-        colorBufferTexture,
-        NULL,
-        colorBuffer,
-        sizeof(uint32_t) * windowWidth);
+    if (frameCallback != NULL)
+    {
+        frameCallback(colorBuffer, windowWidth, windowHeight, colorPitch, frameCallbackData);
+    }
+
+    if (displayBackend == DISPLAY_BACKEND_HEADLESS) return;
+
+    if (isColorBufferLocked)
+    {
+        SDL_UnlockTexture(colorBufferTexture);
+        colorBuffer = ownedColorBuffer;
+        colorPitch = windowWidth;
+        isColorBufferLocked = false;
+    }
+    else
+    {
+        SDL_UpdateTexture(
+            colorBufferTexture,
+            NULL,
+            colorBuffer,
+            sizeof(uint32_t) * colorPitch);
+    }
 
     SDL_RenderCopy(
         renderer,
@@ -123,11 +329,54 @@ void renderColorBuffer()
 // The depth buffer is crucial for correct 3D occlusion (Z-buffering). This function is
 // called at the start of each frame to reset all depth values, ensuring that the first
 // pixel drawn at any location is considered the closest until a closer one is found.
+//
+// The depth ranges of the hierarchical depth blocks are reset too. A block only partly
+// inside the clip rectangle keeps its minimum, and its maximum becomes the clear value,
+// which is never smaller than any depth the block can hold.
 void clearDepthBuffer()
 {
-    for (size_t i = 0; i < windowWidth * windowHeight; i++)
+    rect_t clip = getClipRect();
+    float clearDepth = getDepthClearValue(depthFormat);
+
+    for (int y = clip.minY; y <= clip.maxY; y++)
     {
-        depthBuffer[i] = 1.0;
+        for (int x = clip.minX; x <= clip.maxX; x++)
+        {
+            if (depthFormat == DEPTH_FORMAT_UNORM16) ((uint16_t*)depthBuffer)[y * windowWidth + x] = clearDepth;
+            else ((float*)depthBuffer)[y * windowWidth + x] = clearDepth;
+        }
+    }
+
+    for (int blockY = clip.minY / DEPTH_BLOCK_SIZE; blockY <= clip.maxY / DEPTH_BLOCK_SIZE; blockY++)
+    {
+        for (int blockX = clip.minX / DEPTH_BLOCK_SIZE; blockX <= clip.maxX / DEPTH_BLOCK_SIZE; blockX++)
+        {
+            int block = blockY * blocksPerRow + blockX;
+
+            bool isInside = blockX * DEPTH_BLOCK_SIZE >= clip.minX
+                && blockY * DEPTH_BLOCK_SIZE >= clip.minY
+                && (blockX + 1) * DEPTH_BLOCK_SIZE - 1 <= clip.maxX
+                && (blockY + 1) * DEPTH_BLOCK_SIZE - 1 <= clip.maxY;
+
+            if (isInside || blockMinDepth[block] > clearDepth) blockMinDepth[block] = clearDepth;
+            blockMaxDepth[block] = clearDepth;
+        }
+    }
+}
+
+// Resets every pixel of the visibility buffer to "no triangle".
+// Called at the start of each frame in visibility buffer mode, for the pixels inside the
+// current clip rectangle.
+void clearVisibilityBuffer()
+{
+    rect_t clip = getClipRect();
+
+    for (int y = clip.minY; y <= clip.maxY; y++)
+    {
+        for (int x = clip.minX; x <= clip.maxX; x++)
+        {
+            idBuffer[y * windowWidth + x] = VISIBILITY_NONE;
+        }
     }
 }
 
@@ -175,7 +424,23 @@ bool shouldRenderFillTriangles()
 bool shouldRenderTextures()
 {
     return renderMode == RENDER_MODE_TEXTURED
-        || renderMode == RENDER_MODE_TEXTURED_WIREFRAME;
+        || renderMode == RENDER_MODE_TEXTURED_WIREFRAME
+        || renderMode == RENDER_MODE_TEXTURED_DEPTH_PREPASS;
+}
+
+// Checks if textured triangles are drawn with a depth pre-pass.
+// A helper function for the main render loop: when enabled, a depth-only pass over the
+// triangles comes before the textured pass.
+bool shouldRenderDepthPrepass()
+{
+    return renderMode == RENDER_MODE_TEXTURED_DEPTH_PREPASS;
+}
+
+// Checks if textured triangles are drawn with a visibility buffer (deferred texturing).
+// A helper function for the main render loop.
+bool shouldRenderVisibilityBuffer()
+{
+    return renderMode == RENDER_MODE_TEXTURED_VISIBILITY;
 }
 
 // Returns the current culling mode.
@@ -204,12 +469,16 @@ void setCullingNextMode()
 // (lines, triangles, etc.) are built on top of this.
 //
 // The color buffer is a 1D array, so the 2D coordinates (x, y) must be converted
-// to a 1D index. The formula used is: index = (y * window_width) + x.
+// to a 1D index. The formula used is: index = (y * pitch) + x, where the pitch is the
+// number of pixels from one row to the next (the window width, or more for a locked texture).
+// Pixels outside the current clip rectangle are discarded.
 void drawPixel(int x, int y, uint32_t color)
 {
-    if(x > windowWidth || y > windowHeight) return;
-    
-    colorBuffer[y * windowWidth + x] = color;
+    rect_t clip = getClipRect();
+
+    if (x < clip.minX || x > clip.maxX || y < clip.minY || y > clip.maxY) return;
+
+    colorBuffer[y * colorPitch + x] = mapColor(color);
 }
 
 // Draws a grid pattern onto the color buffer.
@@ -218,13 +487,16 @@ void drawPixel(int x, int y, uint32_t color)
 // drawn if its x or y coordinate is a multiple of `cellSize`.
 void drawGrid(uint8_t cellSize, uint32_t color)
 {
-    for (size_t y = 0; y < windowHeight; y++)
+    rect_t clip = getClipRect();
+    color = mapColor(color);
+
+    for (int y = clip.minY; y <= clip.maxY; y++)
     {
-        for (size_t x = 0; x < windowWidth; x++)
+        for (int x = clip.minX; x <= clip.maxX; x++)
         {
             if (x % cellSize == 0 || y % cellSize == 0)
             {
-                colorBuffer[y * windowWidth + x] = color;
+                colorBuffer[y * colorPitch + x] = color;
             }
         }
     }
@@ -233,398 +505,317 @@ void drawGrid(uint8_t cellSize, uint32_t color)
 // Draws a filled rectangle to the color buffer.
 // A basic 2D drawing primitive, used in this project to draw the small squares
 // that represent vertices when in vertex-rendering mode. It iterates through every
-// pixel from the starting (x, y) to (x + width, y + height) and calls `drawPixel`.
+// pixel from the starting (x, y) to (x + width, y + height), clipped against the current
+// clip rectangle.
 void drawRectangle(int x, int y, int width, int height, uint32_t color)
 {
-    for (size_t pixelY = y; pixelY < y + height; pixelY++)
-    {
-        for (size_t pixelX = x; pixelX < x + width; pixelX++)
-        {
-            colorBuffer[pixelY * windowWidth + pixelX] = color;
-        }   
-    }
-}
-
-// Draws a line between two points using the Digital Differential Analyzer (DDA) algorithm.
-// This is a fundamental rasterization algorithm used to draw the edges of wireframe triangles.
-//
-// Math:
-// 1. Calculate the difference in x and y: deltaX = x1 - x0, deltaY = y1 - y0.
-// 2. Determine the number of steps needed by finding the dimension with the greater change:
-//    longestSideLength = max(|deltaX|, |deltaY|). This ensures the line is continuous.
-// 3. Calculate the increment for x and y for each step:
-//    xIncrement = deltaX / longestSideLength
-//    yIncrement = deltaY / longestSideLength
-//    One of these will be +/-1, and the other will be a value <= 1.
-// 4. Loop `longestSideLength` times, starting from (x0, y0), adding the increments at each
-//    step, and drawing a pixel at the rounded (currentX, currentY) position.
-void drawLine(int x0, int y0, int x1, int y1, uint32_t color)
-{
-    int deltaX = x1 - x0;
-    int deltaY = y1 - y0;
-
-    int longestSideLength = abs(deltaX) >= abs(deltaY) ? abs(deltaX) : abs(deltaY);
+    rect_t clip = getClipRect();
 
-    float xIncrement = deltaX / (float)longestSideLength;
-    float yIncrement = deltaY / (float)longestSideLength;
+    int minX = x > clip.minX ? x : clip.minX;
+    int minY = y > clip.minY ? y : clip.minY;
+    int maxX = x + width - 1 < clip.maxX ? x + width - 1 : clip.maxX;
+    int maxY = y + height - 1 < clip.maxY ? y + height - 1 : clip.maxY;
+    color = mapColor(color);
 
-    float currentX = x0;
-    float currentY = y0;
-
-    for (size_t i = 0; i < longestSideLength; i++)
+    for (int pixelY = minY; pixelY <= maxY; pixelY++)
     {
-        drawPixel(round(currentX), round(currentY), color);
-        currentX += xIncrement;
-        currentY += yIncrement;
+        for (int pixelX = minX; pixelX <= maxX; pixelX++)
+        {
+            colorBuffer[pixelY * colorPitch + pixelX] = color;
+        }   
     }
 }
 
-// Draws the outline of a triangle by calling `drawLine` for each of its three edges.
-// This is used for rendering wireframe modes.
-void drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color)
+// Rounds the quotient of a division up, for a positive `denominator`.
+static long long ceilDivide(long long numerator, long long denominator)
 {
-    drawLine(x0, y0, x1, y1, color);
-    drawLine(x1, y1, x2, y2, color);
-    drawLine(x2, y2, x0, y0, color);
-}
-
-// A utility function to swap the values of two integers.
-// Used internally by the triangle rasterization functions to sort vertices by their y-coordinate.
-void intSwap(int* a, int* b)
-{
-    int temp = *a;
-    *a = *b;
-    *b = temp;
-}
+    long long quotient = numerator / denominator;
 
-// A utility function to swap the values of two floats.
-// Used internally by the textured triangle rasterization function to sort vertex attributes.
-void floatSwap(float* a, float* b)
-{
-    float temp = *a;
-    *a = *b;
-    *b = temp;
+    return quotient + (numerator % denominator > 0);
 }
 
-// Calculates the barycentric weights (alpha, beta, gamma) for a point 'p' inside a triangle (a, b, c).
-// These weights are essential for interpolating attributes (like depth and texture coordinates)
-// across the surface of a triangle during rasterization.
-//
-// Math:
-// Any point 'p' inside a triangle can be expressed as a weighted average of its vertices:
-// p = α*a + β*b + γ*c, where α+β+γ=1.
-// The weights (α, β, γ) are the barycentric coordinates. They represent the ratio of the areas
-// of the sub-triangles formed by 'p' to the area of the main triangle 'abc'.
-//   α = Area(pbc) / Area(abc)
-//   β = Area(apc) / Area(abc)
-//   γ = Area(abp) / Area(abc)
-// The code calculates these areas using a 2D cross-product-like formula. For two vectors
-// v1=(x1, y1) and v2=(x2, y2), the value (x1*y2 - x2*y1) is twice the signed area of the
-// triangle they form with the origin.
-// `areaParallelogramABC` is twice the area of triangle 'abc'.
-// `alpha` is computed using the area of sub-triangle 'pbc'.
-// `beta` is computed using the area of sub-triangle 'apc'.
-// `gamma` is then found using `1 - alpha - beta`.
-vector3_t barycentricWeights(vector2_t a, vector2_t b, vector2_t c, vector2_t p) {
-    
-    vector2_t ac = vector2Sub(c, a);
-    vector2_t ab = vector2Sub(b, a);
-    vector2_t ap = vector2Sub(p, a);
-    vector2_t pc = vector2Sub(c, p);
-    vector2_t pb = vector2Sub(b, p);
-
-    float areaParallelogramABC = (ac.x * ab.y - ac.y * ab.x);
-
-    float alpha = (pc.x * pb.y - pc.y * pb.x) / areaParallelogramABC;
-    float beta = (ac.x * ap.y - ac.y * ap.x) / areaParallelogramABC;
-    float gamma = 1 - alpha - beta;
-
-    vector3_t weights = { alpha, beta, gamma };
-    return weights;
-}
-
-// Draws a single pixel of a filled triangle, performing a depth test.
-// For each pixel inside a triangle, this function interpolates the depth (from the w-component)
-// and compares it with the value in the depth buffer. The pixel is only drawn if it is
-// closer to the camera than what is already in the buffer.
+// Finds the steps of a line whose pixels fall inside the clip range of both axes.
+// The line takes `length` steps along its major axis from `majorStart` (in direction
+// `majorSign`), and its minor coordinate at step k is minorStart + minorSign * m(k), with
+// m(k) the Bresenham offset below. Returns false when no step is inside.
 //
 // Math:
-// 1. Barycentric weights (α, β, γ) are calculated for the pixel's center.
-// 2. For perspective-correct interpolation, we interpolate the reciprocal of the w-component:
-//    1/w_interpolated = α * (1/w_a) + β * (1/w_b) + γ * (1/w_c)
-//    This `w_interpolated` value is proportional to the true z-depth of the pixel in camera space.
-// 3. The depth buffer stores values from 0 (near) to 1 (far). The interpolated value is
-//    compared against the buffer. If it's smaller (closer), the pixel is drawn, and the
-//    depth buffer is updated with the new, closer depth value.
-void drawTrianglePixel(
-    int x, int y, uint32_t color,
-    vector4_t pointA, vector4_t pointB, vector4_t pointC
+// 1. Bresenham picks the minor offset closest to the exact line: m(k) = round(k * d / D),
+//    computed exactly in integers as floor((2*k*d + D) / (2*D)), where D is the major and d
+//    the minor distance.
+// 2. The major coordinate is inside [majorMin, majorMax] for a contiguous range of k, found
+//    directly. m(k) never decreases, so the minor coordinate is inside its range for a
+//    contiguous range of k too: m(k) >= lo  <=>  k >= (2*D*lo - D) / (2*d), and
+//    m(k) <= hi  <=>  k < (2*D*(hi + 1) - D) / (2*d), both rounded up.
+static bool clipLineSteps(
+    int majorStart, int majorSign, int majorMin, int majorMax,
+    int minorStart, int minorSign, int minorMin, int minorMax,
+    long long length, long long minorLength, long long* firstStep, long long* lastStep
 ) {
-    vector2_t p = { x, y };
-    vector2_t a = vector4to2(pointA);
-    vector2_t b = vector4to2(pointB);
-    vector2_t c = vector4to2(pointC);
+    long long first = 0;
+    long long last = length - 1;
 
-    vector3_t weights = barycentricWeights(a, b, c, p);
+    // Distances from the start to the clip range, measured in the direction of the line.
+    long long majorLow = majorSign > 0 ? majorMin - majorStart : majorStart - majorMax;
+    long long majorHigh = majorSign > 0 ? majorMax - majorStart : majorStart - majorMin;
+    long long minorLow = minorSign > 0 ? minorMin - minorStart : minorStart - minorMax;
+    long long minorHigh = minorSign > 0 ? minorMax - minorStart : minorStart - minorMin;
 
-    float alpha = weights.x;
-    float beta = weights.y;
-    float gamma = weights.z;
+    if (majorLow > first) first = majorLow;
+    if (majorHigh < last) last = majorHigh;
 
-    float interpolatedW = (1 / pointA.w) * alpha + (1 / pointB.w) * beta + (1 / pointC.w) * gamma;
+    if (minorLength == 0)
+    {
+        if (minorLow > 0 || minorHigh < 0) return false;
+    }
+    else
+    {
+        long long minorFirst = ceilDivide(2 * length * minorLow - length, 2 * minorLength);
+        long long minorLast = ceilDivide(2 * length * (minorHigh + 1) - length, 2 * minorLength) - 1;
 
-    int pixelIndex = windowWidth * y + x;
+        if (minorFirst > first) first = minorFirst;
+        if (minorLast < last) last = minorLast;
+    }
 
-    interpolatedW = 1 - interpolatedW;
+    *firstStep = first;
+    *lastStep = last;
 
-    if(interpolatedW < depthBuffer[pixelIndex]) {
-        drawPixel(x, y, color);
-        depthBuffer[pixelIndex] = interpolatedW;
-    }
+    return first <= last;
 }
 
-// Draws a single pixel of a textured triangle, performing depth testing and perspective-correct interpolation.
-// This function calculates the correct texture coordinate (UV) for a pixel using barycentric
-// interpolation that is corrected for perspective distortion by using the w-component of the vertices.
-// It then performs a depth test before sampling the texture and drawing the final pixel.
+// Draws a line from (x0, y0) to (x1, y1), excluding the end point, with Bresenham's algorithm.
+// This is the primitive behind the wireframe modes.
+//
+// The line is first clipped against the current clip rectangle as a range of steps (see
+// `clipLineSteps`), so the loop writes straight into the color buffer without testing any
+// pixel. Clipping never moves the line: it starts at the same step with the same error term
+// it would have reached from (x0, y0), so a line crossing several tiles is drawn with exactly
+// the same pixels as it would be in one piece.
 //
 // Math:
-// 1. Barycentric weights (α, β, γ) are calculated for the pixel's center.
-// 2. To find the correct texture coordinates (u, v) for the pixel, we must perform
-//    perspective-correct interpolation. Simple linear interpolation of UVs would cause
-//    visual artifacts (warping). Instead, we interpolate u/w and v/w:
-//    u_persp = α*(u_a/w_a) + β*(u_b/w_b) + γ*(u_c/w_c)
-//    v_persp = α*(v_a/w_a) + β*(v_b/w_b) + γ*(v_c/w_c)
-//    1/w_persp = α*(1/w_a) + β*(1/w_b) + γ*(1/w_c)
-// 3. The final UV coordinates are found by dividing by the interpolated 1/w:
-//    u_final = u_persp / (1/w_persp)
-//    v_final = v_persp / (1/w_persp)
-// 4. A depth test is performed using `w_persp` before the texel is sampled and drawn.
-void drawTexel(
-    int x, int y, uint32_t* texture,
-    vector4_t pointA, vector4_t pointB, vector4_t pointC,
-    texture_t textureA, texture_t textureB, texture_t textureC
-) {
-    vector2_t p = { x, y };
-    vector2_t a = vector4to2(pointA);
-    vector2_t b = vector4to2(pointB);
-    vector2_t c = vector4to2(pointC);
+// 1. With D the longer and d the shorter of |x1 - x0| and |y1 - y0|, the line takes D steps
+//    along the major axis and moves along the minor axis whenever the exact line gets closer
+//    to the next minor coordinate, i.e. when m(k) = floor((2*k*d + D) / (2*D)) increases.
+// 2. The remainder r = (2*k*d + D) mod (2*D) is carried between steps: each step adds 2*d,
+//    and when it reaches 2*D it wraps around and the minor coordinate advances. Only integer
+//    additions and comparisons are left in the loop.
+void drawLine(int x0, int y0, int x1, int y1, uint32_t color)
+{
+    int deltaX = x1 - x0;
+    int deltaY = y1 - y0;
+    int signX = deltaX < 0 ? -1 : 1;
+    int signY = deltaY < 0 ? -1 : 1;
 
-    vector3_t weights = barycentricWeights(a, b, c, p);
+    bool isXMajor = abs(deltaX) >= abs(deltaY);
+    long long length = isXMajor ? abs(deltaX) : abs(deltaY);
+    long long minorLength = isXMajor ? abs(deltaY) : abs(deltaX);
 
-    float alpha = weights.x;
-    float beta = weights.y;
-    float gamma = weights.z;
+    if (length == 0) return;
 
-    float interpolatedU = (textureA.u / pointA.w) * alpha + (textureB.u / pointB.w) * beta + (textureC.u / pointC.w) * gamma;
-    float interpolatedV = (textureA.v / pointA.w) * alpha + (textureB.v / pointB.w) * beta + (textureC.v / pointC.w) * gamma;
-    float interpolatedW = (1 / pointA.w) * alpha + (1 / pointB.w) * beta + (1 / pointC.w) * gamma;
+    rect_t clip = getClipRect();
+    long long firstStep, lastStep;
+    bool isVisible = isXMajor
+        ? clipLineSteps(x0, signX, clip.minX, clip.maxX, y0, signY, clip.minY, clip.maxY, length, minorLength, &firstStep, &lastStep)
+        : clipLineSteps(y0, signY, clip.minY, clip.maxY, x0, signX, clip.minX, clip.maxX, length, minorLength, &firstStep, &lastStep);
 
-    interpolatedU /= interpolatedW;
-    interpolatedV /= interpolatedW;
+    if (!isVisible) return;
 
-    int textureX = abs((int)(interpolatedU * TEXTURE_WIDTH)) % TEXTURE_WIDTH;
-    int textureY = abs((int)(interpolatedV * TEXTURE_HEIGHT)) % TEXTURE_HEIGHT;
+    // Offsets in the color buffer of one step along each axis.
+    int majorStride = isXMajor ? signX : signY * colorPitch;
+    int minorStride = isXMajor ? signY * colorPitch : signX;
 
-    int pixelIndex = windowWidth * y + x;
+    long long numerator = 2 * firstStep * minorLength + length;
+    long long minorOffset = numerator / (2 * length);
+    long long remainder = numerator % (2 * length);
 
-    interpolatedW = 1 - interpolatedW;
+    int x = x0 + signX * (isXMajor ? firstStep : minorOffset);
+    int y = y0 + signY * (isXMajor ? minorOffset : firstStep);
+    uint32_t* pixel = &colorBuffer[y * colorPitch + x];
+    color = mapColor(color);
 
-    if(interpolatedW < depthBuffer[pixelIndex]) {
-        drawPixel(x, y, texture[(64 * textureY) + textureX]);
-        depthBuffer[pixelIndex] = interpolatedW;
+    for (long long step = firstStep; step <= lastStep; step++)
+    {
+        *pixel = color;
+        pixel += majorStride;
+        remainder += 2 * minorLength;
+
+        if (remainder >= 2 * length)
+        {
+            remainder -= 2 * length;
+            pixel += minorStride;
+        }
     }
 }
 
-// Renders a flat-shaded, filled triangle using a scanline algorithm.
-// The function first sorts the triangle's vertices by their y-coordinate. It then splits the
-// triangle into two parts (top and bottom flat) and iterates through the scanlines (rows of pixels)
-// for each part, drawing horizontal lines of pixels. Depth is checked for each pixel using `drawTrianglePixel`.
-//
-// Math:
-// 1. The vertices are sorted vertically (y0 <= y1 <= y2). This simplifies rasterization.
-// 2. The triangle is split horizontally at vertex y1, creating a "flat-bottom" triangle
-//    (p0, p1, and an intermediate point on the p0-p2 edge) and a "flat-top" triangle
-//    (p1, p2, and the same intermediate point).
-// 3. For each part, the algorithm iterates from the top y to the bottom y (scanline by scanline).
-// 4. For each scanline `y`, the start (x_start) and end (x_end) x-coordinates of the
-//    triangle's intersection with that scanline are calculated using linear interpolation
-//    along the triangle's edges. The inverse slopes of the edges are used for efficiency:
-//    x = x_start + (y - y_start) * (dx/dy).
-// 5. A horizontal line is drawn from x_start to x_end. For each pixel in this line,
-//    `drawTrianglePixel` is called to perform a depth test.
+// Draws the outline of a triangle by calling `drawLine` for each of its three edges.
+// This is used for rendering wireframe modes.
+void drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color)
+{
+    drawLine(x0, y0, x1, y1, color);
+    drawLine(x1, y1, x2, y2, color);
+    drawLine(x2, y2, x0, y0, color);
+}
+
+// Renders a flat-shaded, filled triangle with depth testing.
+// The vertices are handed to the shared half-space rasterizer without a texture, so every
+// covered pixel that passes the depth test is written with the triangle's solid color.
 void drawFilledTriangle(
-    int x0, int y0, int z0, int w0,
-    int x1, int y1, int z1, int w1,
-    int x2, int y2, int z2, int w2,
+    int x0, int y0, float z0, float w0,
+    int x1, int y1, float z1, float w1,
+    int x2, int y2, float z2, float w2,
     const uint32_t color)
 {
-    if(y0 > y1)
-    {
-        intSwap(&x0, &x1);
-        intSwap(&y0, &y1);
-        intSwap(&z0, &z1);
-        intSwap(&w0, &w1);
-    }
-
-    if(y1 > y2)
-    {
-        intSwap(&x1, &x2);
-        intSwap(&y1, &y2);
-        intSwap(&z1, &z2);
-        intSwap(&w1, &w2);
-    }
+    int x[3] = { x0, x1, x2 };
+    int y[3] = { y0, y1, y2 };
+    float w[3] = { w0, w1, w2 };
+    framebuffer_t framebuffer = getFramebuffer();
+    rect_t clip = getClipRect();
+    triangleSetup_t setup;
 
-    if(y0 > y1)
-    {
-        intSwap(&x0, &x1);
-        intSwap(&y0, &y1);
-        intSwap(&z0, &z1);
-        intSwap(&w0, &w1);
-    }
+    if (!setupTriangle(&setup, &clip, x, y, w, NULL, NULL)) return;
 
-    vector4_t pointA = { x0, y0, z0, w0 };
-    vector4_t pointB = { x1, y1, z1, w1 };
-    vector4_t pointC = { x2, y2, z2, w2 };
+    statsAdd(STAT_SHADED_FRAGMENTS, rasterizeTriangle(&setup, &framebuffer, RASTER_PASS_COLOR, mapColor(color)));
+}
 
-    float invertedSlopeLeft = 0;
-    float invertedSlopeRight = 0;
+// Prepares a textured triangle and rasterizes it with one of the rasterizer passes.
+// Shared by the single-pass textured drawing and the shading pass of the depth pre-pass.
+static int rasterizeTexturedTriangle(
+    const int x[3], const int y[3], const float w[3], const texture_t uv[3],
+    int pass, const textureImage_t* texture)
+{
+    framebuffer_t framebuffer = getFramebuffer();
+    rect_t clip = getClipRect();
+    triangleSetup_t setup;
 
-    if (y1 - y0 != 0) invertedSlopeLeft = (float)(x1 - x0) / abs(y1 - y0);
-    if (y2 - y0 != 0) invertedSlopeRight = (float)(x2 - x0) / abs(y2 - y0);
+    if (!setupTriangle(&setup, &clip, x, y, w, uv, texture)) return 0;
 
-    if (y1 - y0 != 0) {
-        for (int y = y0; y <= y1; y++) {
-            int xStart = x1 + (y - y1) * invertedSlopeLeft;
-            int xEnd = x0 + (y - y0) * invertedSlopeRight;
+    return rasterizeTriangle(&setup, &framebuffer, pass, 0);
+}
 
-            if (xEnd < xStart) {
-                intSwap(&xStart, &xEnd);
-            }
+// Renders a textured triangle with perspective-correct texturing and depth testing.
+// The UV coordinates are prepared as attribute planes alongside 1/w, so the shared
+// half-space rasterizer can sample the texture at every covered pixel without ever
+// recomputing barycentric weights from scratch.
+void drawTexturedTriangle(
+    int x0, int y0, float z0, float w0, float u0, float v0,
+    int x1, int y1, float z1, float w1, float u1, float v1,
+    int x2, int y2, float z2, float w2, float u2, float v2,
+    const textureImage_t* texture
+)
+{
+    int x[3] = { x0, x1, x2 };
+    int y[3] = { y0, y1, y2 };
+    float w[3] = { w0, w1, w2 };
+    texture_t uv[3] = { { u0, v0 }, { u1, v1 }, { u2, v2 } };
 
-            for (int x = xStart; x < xEnd; x++) {
-                drawPixel(x, y, color);
-            }
-        }
-    }
+    statsAdd(STAT_SHADED_FRAGMENTS, rasterizeTexturedTriangle(x, y, w, uv, RASTER_PASS_COLOR, texture));
+}
 
-    invertedSlopeLeft = 0;
-    invertedSlopeRight = 0;
+// Writes a triangle's depth without touching the color buffer.
+// This is the first pass of the depth pre-pass: once every triangle of the frame has been
+// drawn with it, the depth buffer holds the depth of the visible surface at every pixel.
+// The stripped-down pass never computes UVs or fetches texels.
+void drawTriangleDepth(
+    int x0, int y0, float z0, float w0,
+    int x1, int y1, float z1, float w1,
+    int x2, int y2, float z2, float w2)
+{
+    int x[3] = { x0, x1, x2 };
+    int y[3] = { y0, y1, y2 };
+    float w[3] = { w0, w1, w2 };
+    framebuffer_t framebuffer = getFramebuffer();
+    rect_t clip = getClipRect();
+    triangleSetup_t setup;
 
-    if (y2 - y1 != 0) invertedSlopeLeft = (float)(x2 - x1) / abs(y2 - y1);
-    if (y2 - y0 != 0) invertedSlopeRight = (float)(x2 - x0) / abs(y2 - y0);
+    if (!setupTriangle(&setup, &clip, x, y, w, NULL, NULL)) return;
 
-    if (y2 - y1 != 0) {
-        for (int y = y1; y <= y2; y++) {
-            int xStart = x1 + (y - y1) * invertedSlopeLeft;
-            int xEnd = x0 + (y - y0) * invertedSlopeRight;
+    statsAdd(STAT_DEPTH_PASS_FRAGMENTS, rasterizeTriangle(&setup, &framebuffer, RASTER_PASS_DEPTH_ONLY, 0));
+}
 
-            if (xEnd < xStart) {
-                intSwap(&xStart, &xEnd);
-            }
+// Renders a textured triangle only where it is the visible surface.
+// This is the second pass of the depth pre-pass: a pixel is textured only when its depth is
+// equal to the one left in the depth buffer by `drawTriangleDepth`, so hidden pixels are
+// never shaded and every visible pixel is textured exactly once.
+void drawTexturedTriangleEqualDepth(
+    int x0, int y0, float z0, float w0, float u0, float v0,
+    int x1, int y1, float z1, float w1, float u1, float v1,
+    int x2, int y2, float z2, float w2, float u2, float v2,
+    const textureImage_t* texture
+)
+{
+    int x[3] = { x0, x1, x2 };
+    int y[3] = { y0, y1, y2 };
+    float w[3] = { w0, w1, w2 };
+    texture_t uv[3] = { { u0, v0 }, { u1, v1 }, { u2, v2 } };
 
-            for (int x = xStart; x < xEnd; x++) {
-                drawTrianglePixel(x, y, color, pointA, pointB, pointC);
-            }
-        }
-    }
+    statsAdd(STAT_SHADED_FRAGMENTS, rasterizeTexturedTriangle(x, y, w, uv, RASTER_PASS_EQUAL_DEPTH, texture));
 }
 
-// Renders a textured triangle using a scanline algorithm with perspective-correct texturing.
-// Similar to `drawFilledTriangle`, it sorts vertices and uses a scanline approach. However, for
-// each pixel, it calls `drawTexel`, which performs perspective-correct interpolation of UV
-// coordinates before sampling the texture and drawing the pixel, ensuring the texture does not
-// appear warped on surfaces angled away from the camera.
-//
-// Math:
-// The overall approach is the same as `drawFilledTriangle` (vertex sorting, splitting into
-// two sub-triangles, iterating scanlines). The key difference is that instead of drawing
-// a solid color, it calls `drawTexel` for each pixel along the horizontal scanline.
-// `drawTexel` handles the complex mathematics of perspective-correct texture coordinate
-// interpolation and depth testing, as described in its own documentation block.
-void drawTexturedTriangle(
-    int x0, int y0, int z0, int w0, float u0, float v0,
-    int x1, int y1, int z1, int w1, float u1, float v1,
-    int x2, int y2, int z2, int w2, float u2, float v2,
-    uint32_t* texture
-)
+// Prepares the frame's triangles for the visibility buffer resolve.
+// Called once per frame, before the tiles are rendered, with the same triangles whose
+// indices are written by `drawTriangleVisibility`. The setups are made against the whole
+// window, so any tile can resolve any of them.
+void setupVisibilityBuffer(const triangle_t* triangles, int numberTriangles)
 {
-    if(y0 > y1)
-    {
-        intSwap(&x0, &x1);
-        intSwap(&y0, &y1);
-        intSwap(&z0, &z1);
-        intSwap(&w0, &w1);
-        floatSwap(&u0, &u1);
-        floatSwap(&v0, &v1);
-    }
+    rect_t window = { 0, 0, windowWidth - 1, windowHeight - 1 };
 
-    if(y1 > y2)
+    if (numberTriangles > visibilitySetupsCapacity)
     {
-        intSwap(&x1, &x2);
-        intSwap(&y1, &y2);
-        intSwap(&z1, &z2);
-        intSwap(&w1, &w2);
-        floatSwap(&u1, &u2);
-        floatSwap(&v1, &v2);
+        visibilitySetupsCapacity = numberTriangles * 2;
+        visibilitySetups = realloc(visibilitySetups, sizeof(triangleSetup_t) * visibilitySetupsCapacity);
     }
 
-    if(y0 > y1)
+    for (int i = 0; i < numberTriangles; i++)
     {
-        intSwap(&x0, &x1);
-        intSwap(&y0, &y1);
-        intSwap(&z0, &z1);
-        intSwap(&w0, &w1);
-        floatSwap(&u0, &u1);
-        floatSwap(&v0, &v1);
-    }
-
-    vector4_t pointA = { x0, y0, z0, w0 };
-    vector4_t pointB = { x1, y1, z1, w1 };
-    vector4_t pointC = { x2, y2, z2, w2 };
-    texture_t textureA = { u0, v0 };
-    texture_t textureB = { u1, v1 };
-    texture_t textureC = { u2, v2 };
+        const triangle_t* triangle = &triangles[i];
+        int x[3], y[3];
+        float w[3];
 
-    float invertedSlopeLeft = 0;
-    float invertedSlopeRight = 0;
-
-    if (y1 - y0 != 0) invertedSlopeLeft = (float)(x1 - x0) / abs(y1 - y0);
-    if (y2 - y0 != 0) invertedSlopeRight = (float)(x2 - x0) / abs(y2 - y0);
-
-    if (y1 - y0 != 0) {
-        for (int y = y0; y <= y1; y++) {
-            int xStart = x1 + (y - y1) * invertedSlopeLeft;
-            int xEnd = x0 + (y - y0) * invertedSlopeRight;
-
-            if (xEnd < xStart) {
-                intSwap(&xStart, &xEnd);
-            }
-
-            for (int x = xStart; x < xEnd; x++) {
-                drawTexel(x, y, texture, pointA, pointB, pointC, textureA, textureB, textureC);
-            }
+        for (int v = 0; v < 3; v++)
+        {
+            x[v] = triangle->points[v].x;
+            y[v] = triangle->points[v].y;
+            w[v] = triangle->points[v].w;
         }
+
+        // A triangle rejected here covers no pixel, so its index never reaches the resolve.
+        setupTriangle(&visibilitySetups[i], &window, x, y, w, triangle->textureCoordinates, triangle->texture);
     }
+}
 
-    invertedSlopeLeft = 0;
-    invertedSlopeRight = 0;
+// Writes a triangle's index and depth into the visibility and depth buffers.
+// This is the first pass of deferred texturing: the triangle is rasterized as a flat
+// triangle whose "color" is its index, into the visibility buffer instead of the color
+// buffer, so no attribute is interpolated and no texel is fetched.
+void drawTriangleVisibility(
+    int x0, int y0, float z0, float w0,
+    int x1, int y1, float z1, float w1,
+    int x2, int y2, float z2, float w2,
+    uint32_t triangleIndex)
+{
+    int x[3] = { x0, x1, x2 };
+    int y[3] = { y0, y1, y2 };
+    float w[3] = { w0, w1, w2 };
+    framebuffer_t framebuffer = getFramebuffer();
+    rect_t clip = getClipRect();
+    triangleSetup_t setup;
 
-    if (y2 - y1 != 0) invertedSlopeLeft = (float)(x2 - x1) / abs(y2 - y1);
-    if (y2 - y0 != 0) invertedSlopeRight = (float)(x2 - x0) / abs(y2 - y0);
+    if (!setupTriangle(&setup, &clip, x, y, w, NULL, NULL)) return;
 
-    if (y2 - y1 != 0) {
-        for (int y = y1; y <= y2; y++) {
-            int xStart = x1 + (y - y1) * invertedSlopeLeft;
-            int xEnd = x0 + (y - y0) * invertedSlopeRight;
+    framebuffer.colorBuffer = idBuffer;
+    framebuffer.colorPitch = windowWidth;
 
-            if (xEnd < xStart) {
-                intSwap(&xStart, &xEnd);
-            }
+    statsAdd(STAT_DEPTH_PASS_FRAGMENTS, rasterizeTriangle(&setup, &framebuffer, RASTER_PASS_COLOR, triangleIndex));
+}
 
-            for (int x = xStart; x < xEnd; x++) {
-                drawTexel(x, y, texture, pointA, pointB, pointC, textureA, textureB, textureC);
-            }
-        }
-    }
-}
\ No newline at end of file
+// Textures every pixel of the visibility buffer inside the current clip rectangle.
+// This is the second pass of deferred texturing: each visible pixel looks up its triangle,
+// interpolates its UVs and samples its triangle's texture exactly once, so the shading cost
+// depends on the number of pixels rather than on how many triangles covered them.
+void resolveVisibilityBuffer()
+{
+    framebuffer_t framebuffer = getFramebuffer();
+    rect_t clip = getClipRect();
+
+    statsAdd(STAT_SHADED_FRAGMENTS, resolveVisibility(&framebuffer, &clip, visibilitySetups));
+}
@@ -2,6 +2,7 @@
 #define DISPLAY
 
 #include <SDL2/SDL.h>
+#include "triangle.h"
 
 enum RenderMode
 {
@@ -10,7 +11,9 @@ enum RenderMode
     RENDER_MODE_FILL_TRIANGLE,
     RENDER_MODE_FILL_TRIANGLE_WIREFRAME,
     RENDER_MODE_TEXTURED,
-    RENDER_MODE_TEXTURED_WIREFRAME
+    RENDER_MODE_TEXTURED_WIREFRAME,
+    RENDER_MODE_TEXTURED_DEPTH_PREPASS,
+    RENDER_MODE_TEXTURED_VISIBILITY
 };
 
 enum CullingMode
@@ -19,16 +22,41 @@ enum CullingMode
     CULLING_MODE_BACK
 };
 
+// Where finished frames go.
+enum DisplayBackend
+{
+    // An SDL window, presented through a streaming texture.
+    DISPLAY_BACKEND_WINDOW,
+    // No window and no video initialization: the buffers live in memory only and frames
+    // are only handed to the frame callback. For render nodes, benchmarks and tests.
+    DISPLAY_BACKEND_HEADLESS
+};
+
+// Receives every finished frame: `pixels` holds `height` rows of `width` pixels in the color
+// format (see color.h), `pitch` pixels apart. The pixels are only valid during the call.
+typedef void (*frameCallbackFunction)(const uint32_t* pixels, int width, int height, int pitch, void* userData);
+
+void setWindowSize(int width, int height);
+void setZeroCopyPresent(bool isZeroCopy);
+void setDepthFormat(int format, float zNear);
+void setDisplayBackend(int backend);
+int getDisplayBackend();
+void setFrameCallback(frameCallbackFunction callback, void* userData);
 void initializeWindow(bool* isRunning);
 void destroyWindow();
 
 int getWindowWidth();
 int getWindowHeight();
 
+void setClipRect(int x, int y, int width, int height);
+void resetClipRect();
+
 void clearColorBuffer(uint32_t color);
+void lockColorBuffer();
 void renderColorBuffer();
 
 void clearDepthBuffer();
+void clearVisibilityBuffer();
 
 int getRenderMode();
 void setRenderMode(int mode);
@@ -41,6 +69,8 @@ bool shouldRenderVertex();
 bool shouldRenderWireframe();
 bool shouldRenderFillTriangles();
 bool shouldRenderTextures();
+bool shouldRenderDepthPrepass();
+bool shouldRenderVisibilityBuffer();
 
 void drawPixel(int x, int y, uint32_t color);
 void drawGrid(uint8_t cellSize, uint32_t color);
@@ -48,15 +78,41 @@ void drawRectangle(int x, int y, int width, int height, uint32_t color);
 void drawLine(int x0, int y0, int x1, int y1, uint32_t color);
 void drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color);
 void drawFilledTriangle(
-    int x0, int y0, int z0, int w0,
-    int x1, int y1, int z1, int w1,
-    int x2, int y2, int z2, int w2,
+    int x0, int y0, float z0, float w0,
+    int x1, int y1, float z1, float w1,
+    int x2, int y2, float z2, float w2,
     const uint32_t color);
+// Signature shared by the textured triangle drawing functions.
+typedef void (*texturedTriangleFunction)(
+    int x0, int y0, float z0, float w0, float u0, float v0,
+    int x1, int y1, float z1, float w1, float u1, float v1,
+    int x2, int y2, float z2, float w2, float u2, float v2,
+    const textureImage_t* texture
+);
+
 void drawTexturedTriangle(
-    int x0, int y0, int z0, int w0, float u0, float v0,
-    int x1, int y1, int z1, int w1, float u1, float v1,
-    int x2, int y2, int z2, int w2, float u2, float v2,
-    uint32_t* texture
+    int x0, int y0, float z0, float w0, float u0, float v0,
+    int x1, int y1, float z1, float w1, float u1, float v1,
+    int x2, int y2, float z2, float w2, float u2, float v2,
+    const textureImage_t* texture
 );
+void drawTriangleDepth(
+    int x0, int y0, float z0, float w0,
+    int x1, int y1, float z1, float w1,
+    int x2, int y2, float z2, float w2);
+void drawTexturedTriangleEqualDepth(
+    int x0, int y0, float z0, float w0, float u0, float v0,
+    int x1, int y1, float z1, float w1, float u1, float v1,
+    int x2, int y2, float z2, float w2, float u2, float v2,
+    const textureImage_t* texture
+);
+
+void setupVisibilityBuffer(const triangle_t* triangles, int numberTriangles);
+void drawTriangleVisibility(
+    int x0, int y0, float z0, float w0,
+    int x1, int y1, float z1, float w1,
+    int x2, int y2, float z2, float w2,
+    uint32_t triangleIndex);
+void resolveVisibilityBuffer();
 
 #endif
\ No newline at end of file
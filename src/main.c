@@ -1,8 +1,11 @@
 #include <stdio.h>
 #include <stdbool.h>
+#include <math.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 #include "array/array.h"
 #include "display.h"
+#include "rasterizer.h"
 #include "vector.h"
 #include "projection.h"
 #include "cube.h"
@@ -12,67 +15,214 @@
 #include "texture.h"
 #include "camera.h"
 #include "clipping.h"
-
-#define TARGET_FRAME_RATE 60
-#define TARGET_FRAME_TIME (1000 / TARGET_FRAME_RATE)
+#include "tiles.h"
+#include "stats.h"
+#include "atlas.h"
+#include "view.h"
+#include "scheduler.h"
+#include "bvh.h"
 
 #define FOV M_PI / 3
 #define Z_NEAR 0.01
 #define Z_FAR 100
 
-#define MAX_TRIANGLES 10000
+// Distance between the two cameras of the stereo view layout.
+#define EYE_SEPARATION 1.0
 
 bool isRunning = false;
 
-triangle_t trianglesToRender[MAX_TRIANGLES];
+// The frame's screen-space triangles, for every view, in drawing order. The buffer grows with
+// the triangles the views see (see `reserveTrianglesToRender`), so a crowd of instances is
+// never cut short.
+triangle_t* trianglesToRender = NULL;
 int numberTrianglesToRender = 0;
+int trianglesToRenderCapacity = 0;
 
 mesh_t* cube;
 mesh_t* piramid;
 
-matrix4_t projectionMatrix;
+light_t light;
 
-Uint32 previousFrameTicks;
+camera_t camera;
 
-light_t light;
+// How the window is split into views, all following `camera`.
+enum ViewLayout
+{
+    // One view covering the whole window.
+    VIEW_LAYOUT_SINGLE,
+    // A stereo pair side by side: the left and right eyes, EYE_SEPARATION apart.
+    VIEW_LAYOUT_STEREO,
+    // The six 90 degree faces of a cube map around the camera, in a 3x2 grid of squares.
+    VIEW_LAYOUT_CUBE
+};
 
-uint32_t* texture = NULL;
-upng_t* png = NULL;
+int viewLayout = VIEW_LAYOUT_SINGLE;
+view_t views[MAX_VIEWS];
+int numberViews = 0;
 
-camera_t camera;
+// Post-transform vertex cache: every vertex of the mesh being processed, transformed once for
+// the view it is processed for, and read by its faces by index. Vertices are in the view's
+// camera space and clip space (as vertex streams, see `allocateVertexStream`), with their
+// outcodes, and projected to the view's screen when they are in front of the camera (between
+// the near and far planes).
+float* cameraX = NULL;
+float* cameraY = NULL;
+float* cameraZ = NULL;
+float* clipX = NULL;
+float* clipY = NULL;
+float* clipZ = NULL;
+float* clipW = NULL;
+vector4_t* screenVertices = NULL;
+int* vertexOutcodes = NULL;
+int vertexCacheCapacity = 0;
+
+// The culling results of a frame for a list of objects (the scene's meshes, or the instances
+// of a mesh), all with room for every object: the objects one view's culling found and where
+// they lie relative to its frustum, the objects found by any view (in list order), and where
+// every object lies relative to each view's frustum (FRUSTUM_OUTSIDE for the views that did
+// not find it).
+typedef struct {
+    int* viewIndices;
+    int* viewFrustumTests;
+    int* visible;
+    int numberVisible;
+    int (*frustumTests)[MAX_VIEWS];
+    int capacity;
+} visibility_t;
+
+visibility_t meshVisibility;
+visibility_t instanceVisibility;
+
+// Number of instances of the cube laid out on a grid in front of the camera (see `--objects`),
+// and the distance between neighbouring instances (see `--object-spacing`).
+int numberExtraObjects = 0;
+float extraObjectSpacing = 6.0f;
+
+bool shouldPrintStats = false;
+bool shouldBuildAtlas = true;
+Uint32 previousStatsTicks;
+
+// Headless runs render a fixed number of frames in one render mode, and can write the last
+// frame to an image file.
+int headlessFrames = 0;
+int headlessRenderMode = RENDER_MODE_TEXTURED;
+int renderedFrames = 0;
+
+// Makes room in a visibility list for `count` objects, and empties it. Every object starts
+// outside every view's frustum.
+void reserveVisibility(visibility_t* visibility, int count)
+{
+    visibility->numberVisible = 0;
+
+    if (count <= visibility->capacity) return;
+
+    visibility->viewIndices = realloc(visibility->viewIndices, sizeof(int) * count);
+    visibility->viewFrustumTests = realloc(visibility->viewFrustumTests, sizeof(int) * count);
+    visibility->visible = realloc(visibility->visible, sizeof(int) * count);
+    visibility->frustumTests = realloc(visibility->frustumTests, sizeof(*visibility->frustumTests) * count);
+
+    for (int o = visibility->capacity; o < count; o++)
+    {
+        for (int i = 0; i < MAX_VIEWS; i++)
+        {
+            visibility->frustumTests[o][i] = FRUSTUM_OUTSIDE;
+        }
+    }
+
+    visibility->capacity = count;
+}
 
-plane_t frustumPlanes[FRUSTUM_NUM_PLANES];
+// Adds the `numberFound` objects view `view` found (in `viewIndices` and `viewFrustumTests`)
+// to the objects found by any view.
+void addViewVisibility(visibility_t* visibility, int view, int numberFound)
+{
+    for (int k = 0; k < numberFound; k++)
+    {
+        const int o = visibility->viewIndices[k];
+        bool isListed = false;
+
+        for (int i = 0; i < numberViews; i++)
+        {
+            if (visibility->frustumTests[o][i] != FRUSTUM_OUTSIDE) isListed = true;
+        }
+
+        if (!isListed) visibility->visible[visibility->numberVisible++] = o;
+        visibility->frustumTests[o][view] = visibility->viewFrustumTests[k];
+    }
+}
+
+int compareIndices(const void* a, const void* b)
+{
+    return *(const int*)a - *(const int*)b;
+}
+
+// Sorts the objects found by any view back into list order, whichever order the views found
+// them in, so they are always drawn in the same order.
+void sortVisibility(visibility_t* visibility)
+{
+    qsort(visibility->visible, visibility->numberVisible, sizeof(int), compareIndices);
+}
+
+// Leaves object `o` outside every view's frustum again, for the next time the list is used.
+void clearVisibility(visibility_t* visibility, int o)
+{
+    for (int i = 0; i < numberViews; i++)
+    {
+        visibility->frustumTests[o][i] = FRUSTUM_OUTSIDE;
+    }
+}
+
+void freeVisibility(visibility_t* visibility)
+{
+    free(visibility->viewIndices);
+    free(visibility->viewFrustumTests);
+    free(visibility->visible);
+    free(visibility->frustumTests);
+}
 
 // Sets up the initial state of the scene.
 // This function is called once at the start of the application. It handles:
 // - Loading assets like 3D models (.obj) and textures (.png).
-// - Setting up the projection matrix based on window dimensions and field of view.
-// - Initializing the clipping planes of the view frustum.
 // - Configuring default rendering modes, lighting, and camera position.
 void setupScene()
 {
     cube = loadMesh("./assets/cube.obj");
     piramid = loadMesh("./assets/piramid.obj");
 
-    float aspectY = (float)getWindowHeight() / (float)getWindowWidth();
-    float aspectX = (float)getWindowWidth() / (float)getWindowHeight();
-    float fovY = FOV;
-    float fovX = atan(tan(fovY / 2) * aspectX) * 2;
-      
-    initFrustumPlane(frustumPlanes, fovX, fovY, Z_NEAR, Z_FAR);
-    
-    projectionMatrix = matrix4MakePerspective( FOV, aspectY, Z_NEAR, Z_FAR );
-    
-    previousFrameTicks = SDL_GetTicks();
-
-    setRenderMode(RENDER_MODE_TEXTURED);
+    // Instances of the cube on a square grid on the floor below the camera, to measure how the
+    // scene scales with the number of objects. With the default spacing most of them are out
+    // of sight (beyond the far plane); a smaller spacing keeps many more in view.
+    mesh_t* extraObjects = numberExtraObjects > 0 ? loadMesh("./assets/cube.obj") : NULL;
+    const int gridSide = (int)ceil(sqrt(numberExtraObjects));
+    const uint32_t tints[] = { 0xFF8080FF, 0x80FF80FF, 0x8080FFFF, 0xFFFF80FF };
+
+    for (int i = 0; i < numberExtraObjects; i++)
+    {
+        addMeshInstance(extraObjects, (meshInstance_t){
+            .position = { (i % gridSide - gridSide / 2) * extraObjectSpacing, -10, 10 + (i / gridSide) * extraObjectSpacing },
+            .rotation = { 0, 0, 0 },
+            .scale = { 1, 1, 1 },
+            .tint = tints[i % 4]
+        });
+    }
+
+    setRenderMode(getDisplayBackend() == DISPLAY_BACKEND_HEADLESS ? headlessRenderMode : RENDER_MODE_TEXTURED);
     setCullingMode(CULLING_MODE_BACK);
 
     light = (light_t){
         (vector3_t){ 0, 0, 1 }
     };
 
-    loadTextureFromPng("./assets/cube.png", &png, &texture);
+    // Both meshes share the cube's texture.
+    const textureImage_t* cubeTexture = loadTextureFromPng("./assets/cube.png", TEXTURE_WRAP_REPEAT);
+    cube->texture = cubeTexture;
+    piramid->texture = cubeTexture;
+
+    if (extraObjects != NULL) extraObjects->texture = cubeTexture;
+
+    // Packs the meshes' textures into one page, so the whole scene samples a single texture.
+    if (shouldBuildAtlas) buildMeshTextureAtlas();
+    if (shouldPrintStats) printAtlasStats();
 
     camera = (camera_t){
         .position = { 0, 0, 0 },
@@ -83,7 +233,20 @@ void setupScene()
 // Frees all allocated resources before the application closes.
 // This function is called once upon exiting to prevent memory leaks.
 void clearScene() {
-    upng_free(png);
+    free(cameraX);
+    free(cameraY);
+    free(cameraZ);
+    free(clipX);
+    free(clipY);
+    free(clipZ);
+    free(clipW);
+    free(screenVertices);
+    free(vertexOutcodes);
+    free(trianglesToRender);
+    freeVisibility(&meshVisibility);
+    freeVisibility(&instanceVisibility);
+    freeSceneBvh();
+    freeAllTextures();
     freeAllMeshes();
 }
 
@@ -128,6 +291,14 @@ void processInput()
         {
             setRenderMode(RENDER_MODE_TEXTURED_WIREFRAME);
         }
+        if(event.key.keysym.sym == SDLK_7)
+        {
+            setRenderMode(RENDER_MODE_TEXTURED_DEPTH_PREPASS);
+        }
+        if(event.key.keysym.sym == SDLK_8)
+        {
+            setRenderMode(RENDER_MODE_TEXTURED_VISIBILITY);
+        }
         if(event.key.keysym.sym == SDLK_c)
         {
             setCullingNextMode();
@@ -164,171 +335,555 @@ void processInput()
     }
 }
 
-// This is the core of the rendering pipeline, executed once per frame.
-// It processes all game objects from 3D space to 2D screen space triangles.
-void update()
+// Builds the views of the frame for the current view layout, from the camera and the window size.
+// Rebuilt every frame so the views follow the camera as it moves.
+void layoutViews()
 {
-    // --- 1. Frame Timing ---
-    // Caps the frame rate to the target value.
-    int frameTime = SDL_GetTicks() - previousFrameTicks;
-    
-    if(frameTime < TARGET_FRAME_TIME)
+    int width = getWindowWidth();
+    int height = getWindowHeight();
+    vector3_t up = { 0, 1, 0 };
+
+    if (viewLayout == VIEW_LAYOUT_STEREO)
     {
-        SDL_Delay(TARGET_FRAME_TIME - frameTime);
-        frameTime = SDL_GetTicks() - previousFrameTicks;
+        camera_t leftEye = camera;
+        camera_t rightEye = camera;
+        leftEye.position.x -= EYE_SEPARATION / 2;
+        rightEye.position.x += EYE_SEPARATION / 2;
+
+        views[0] = makeView(leftEye, up, FOV, Z_NEAR, Z_FAR, 0, 0, width / 2, height);
+        views[1] = makeView(rightEye, up, FOV, Z_NEAR, Z_FAR, width / 2, 0, width - width / 2, height);
+        numberViews = 2;
     }
+    else if (viewLayout == VIEW_LAYOUT_CUBE)
+    {
+        // +X, -X, +Y, -Y, +Z and -Z, each with an up direction that is not parallel to it.
+        const vector3_t directions[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+        const vector3_t ups[6] = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, 1, 0 }, { 0, 1, 0 } };
+        int size = width / 3 < height / 2 ? width / 3 : height / 2;
 
-    float frameTimeSeconds = frameTime / 1000.0f;
-    previousFrameTicks = SDL_GetTicks();
+        for (int i = 0; i < 6; i++)
+        {
+            camera_t face = { .position = camera.position, .direction = directions[i] };
+            views[i] = makeView(face, ups[i], M_PI / 2, Z_NEAR, Z_FAR, (i % 3) * size, (i / 3) * size, size, size);
+        }
 
-    // --- 2. Object & Camera Updates ---
-    // Updates object transformations (position, rotation, scale).
-    // Creates the view matrix based on the camera's current position and orientation.
-    float rotationIncrement = 1 * frameTimeSeconds;
+        numberViews = 6;
+    }
+    else
+    {
+        views[0] = makeView(camera, up, FOV, Z_NEAR, Z_FAR, 0, 0, width, height);
+        numberViews = 1;
+    }
+}
 
-    cube->position = (vector3_t){ 0, 0, 30 };
-    // cube.rotation = vector3Sum( cube.rotation, (vector3_t){ rotationIncrement, rotationIncrement, rotationIncrement } );
-    cube->scale = (vector3_t){ 2, 2, 2};
+// Tests a mesh's bounding volumes against a view's frustum, returning a FrustumTest.
+// The bounding sphere is tested first, against the view's world-space frustum planes: it only
+// needs the sphere's center transformed, and settles most meshes, which are either well
+// outside the view or well inside it. A sphere crossing a plane may still belong to a mesh
+// that does not, so the tighter bounding box is then tested in clip space.
+//
+// Math: the transform scales, rotates and translates the mesh. Rotation and translation keep
+// distances, so the world-space sphere has the transformed center, and a radius scaled by the
+// largest of the three scale factors.
+int classifyMeshView(const mesh_t* mesh, const matrix4_t* transformMatrix, const view_t* view)
+{
+    // A mesh drawn as instances is bounded by the box around its instances, whose own spheres
+    // are tested by `processMeshInstances`.
+    if (mesh->instances != NULL)
+    {
+        matrix4_t clipMatrix = matrix4MultiplyMatrix4(&view->viewProjectionMatrix, transformMatrix);
+        return classifyBox(&clipMatrix, mesh->instancesMin, mesh->instancesMax);
+    }
 
-    piramid->position = (vector3_t){ 0, 10, 30 };
-    // piramid.rotation = vector3Sum( piramid.rotation, (vector3_t){ 0, rotationIncrement, 0 } );
-    piramid->scale = (vector3_t){ 2, 2, 2 };
+    vector3_t worldCenter = matrix4MultiplyPointAffine(transformMatrix, &mesh->boundingCenter);
+    float largestScale = fmax(fabs(mesh->scale.x), fmax(fabs(mesh->scale.y), fabs(mesh->scale.z)));
 
-    vector3_t eye = camera.position;
-    vector3_t target = { camera.position.x, camera.position.y, camera.position.z + 1 };
-    vector3_t up = { 0, 1, 0 };
-    matrix4_t viewMatrix = matrix4LookAt(&eye, &target, &up);
+    int result = classifySphere(view->frustumPlanes, worldCenter, mesh->boundingRadius * largestScale);
+    if (result != FRUSTUM_INTERSECTS) return result;
 
-    const int numMeshes = getNumberMeshes();
-    numberTrianglesToRender = 0;
+    matrix4_t clipMatrix = matrix4MultiplyMatrix4(&view->viewProjectionMatrix, transformMatrix);
 
-    // --- 3. Geometry Processing Loop (per-mesh, per-face) ---
-    // This loop iterates through every triangle of every mesh in the scene.
-    for (size_t m = 0; m < numMeshes; m++)
+    return classifyBox(&clipMatrix, mesh->boundsMin, mesh->boundsMax);
+}
+
+// Makes room for `count` more triangles to render. The buffer doubles when it grows, so it
+// settles after the first frames at the size the scene needs.
+void reserveTrianglesToRender(int count)
+{
+    if (numberTrianglesToRender + count <= trianglesToRenderCapacity) return;
+
+    trianglesToRenderCapacity = (numberTrianglesToRender + count) * 2;
+    trianglesToRender = realloc(trianglesToRender, sizeof(triangle_t) * trianglesToRenderCapacity);
+}
+
+// Makes room in the post-transform vertex cache for `numVertices` vertices.
+void reserveVertexCache(int numVertices)
+{
+    if (numVertices <= vertexCacheCapacity) return;
+
+    float** streams[] = { &cameraX, &cameraY, &cameraZ, &clipX, &clipY, &clipZ, &clipW };
+
+    for (int i = 0; i < 7; i++)
     {
-        mesh_t* mesh = getMesh(m);
-        matrix4_t transformMatrix = getMeshTransformMatrix(mesh);
+        free(*streams[i]);
+        *streams[i] = allocateVertexStream(numVertices);
+    }
+
+    screenVertices = realloc(screenVertices, sizeof(vector4_t) * numVertices);
+    vertexOutcodes = realloc(vertexOutcodes, sizeof(int) * numVertices);
+    vertexCacheCapacity = numVertices;
+}
 
-        const int numFaces = array_length(mesh->faces);
+// Fills the post-transform vertex cache with the vertices of a mesh, transformed by
+// `transformMatrix` for one view, in a single pass over the mesh's vertices. A vertex shared
+// by several faces (six on average in a closed mesh) is transformed, classified and projected
+// once instead of once per face. The transformations run on the mesh's vertex streams, 4 or 8
+// vertices at a time (see `matrix4TransformPoints`).
+//
+// Math: a vertex v goes to camera space through the view matrix V after the mesh's transform
+// M, as V * (M * v) = (V * M) * v. Concatenating the two matrices once per mesh and view costs
+// a single matrix product, and leaves one matrix-vector product per vertex. V * M is affine,
+// so camera-space vertices have w = 1, and go to clip space as points too.
+void transformMeshToView(const mesh_t* mesh, const matrix4_t* transformMatrix, const view_t* view, int frustumTest)
+{
+    const int numVertices = array_length(mesh->vertices);
+    const int numPadded = paddedVertexCount(numVertices);
+
+    reserveVertexCache(numPadded);
+
+    matrix4_t viewMatrix = getViewMatrix(view);
+    matrix4_t modelViewMatrix = matrix4MultiplyAffine(&viewMatrix, transformMatrix);
+
+    matrix4TransformPoints(&modelViewMatrix, mesh->vertexX, mesh->vertexY, mesh->vertexZ, cameraX, cameraY, cameraZ, NULL, numPadded);
+    matrix4TransformPoints(&view->projectionMatrix, cameraX, cameraY, cameraZ, clipX, clipY, clipZ, clipW, numPadded);
+
+    for (int v = 0; v < numVertices; v++)
+    {
+        vector4_t clipVertex = { clipX[v], clipY[v], clipZ[v], clipW[v] };
 
-        for (size_t f = 0; f < numFaces; f++)
+        // Vertices of a mesh inside the frustum are inside every plane.
+        vertexOutcodes[v] = frustumTest == FRUSTUM_INSIDE ? 0 : computeOutcode(clipVertex);
+
+        if (!(vertexOutcodes[v] & OUTCODE_NEAR_FAR))
         {
-            face_t face = mesh->faces[f];
-            vector3_t faceVertices[3];
-            
-            faceVertices[0] = mesh->vertices[face.a - 1];
-            faceVertices[1] = mesh->vertices[face.b - 1];
-            faceVertices[2] = mesh->vertices[face.c - 1];
-            
-            // --- 3a. Model and View Transformation ---
-            // Transforms vertices from model space -> world space -> camera space.
-            vector4_t transformedVertices[3];
+            screenVertices[v] = projectToView(view, &clipVertex);
+        }
+    }
+}
+
+// Processes the faces of a mesh, transformed by `transformMatrix`, for one view: from model
+// space into the view's camera space, through culling and clipping, to triangles in the
+// view's viewport, appended to the triangles to render. `frustumTest` is where the mesh's
+// bounds lie relative to the view frustum: the faces of a mesh inside it are never clipped.
+// `color` is the base color of the faces, shaded by the light.
+void processMeshView(const mesh_t* mesh, const matrix4_t* transformMatrix, const view_t* view, int frustumTest, uint32_t color)
+{
+    // --- 3a. View & Projection Transformation ---
+    // Transforms the mesh's vertices into the view's camera space, and from there into its
+    // clip space by the projection matrix, once per vertex (see `transformMeshToView`).
+    transformMeshToView(mesh, transformMatrix, view, frustumTest);
+
+    const int numFaces = array_length(mesh->faces);
+    int numberAccepted = 0;
+    int numberRejected = 0;
+    int numberClipped = 0;
+
+    for (size_t f = 0; f < numFaces; f++)
+    {
+        face_t face = mesh->faces[f];
+        const int indices[3] = { face.a - 1, face.b - 1, face.c - 1 };
+        vector4_t transformedVertices[3];
+        vector4_t clipVertices[3];
+        int outcodes[3];
 
+        for (size_t v = 0; v < 3; v++)
+        {
+            transformedVertices[v] = (vector4_t){ cameraX[indices[v]], cameraY[indices[v]], cameraZ[indices[v]], 1 };
+            clipVertices[v] = (vector4_t){ clipX[indices[v]], clipY[indices[v]], clipZ[indices[v]], clipW[indices[v]] };
+            outcodes[v] = vertexOutcodes[indices[v]];
+        }
+
+        // --- 3b. Trivial Rejection ---
+        // Each vertex was classified against the 6 planes of the view frustum with an
+        // outcode. The triangle is discarded if all its vertices are outside the same plane.
+        if (outcodes[0] & outcodes[1] & outcodes[2])
+        {
+            numberRejected++;
+            continue;
+        }
+
+        // --- 3c. Back-face Culling ---
+        // Checks if the triangle is facing away from the camera and discards it if so.
+        vector3_t verticesForBackCulling[3] = {
+            vector4to3(transformedVertices[0]),
+            vector4to3(transformedVertices[1]),
+            vector4to3(transformedVertices[2])
+        };
+
+        if(getCullingMode() == CULLING_MODE_NONE && !isFaceFacingCamera(view->camera.position, verticesForBackCulling)) continue;
+
+        // --- 3d. Clipping & Projection ---
+        // Projects the triangle to the view's screen coordinates. Triangles inside the
+        // frustum, and most of the ones crossing its sides (which lie inside the guard band),
+        // are handed to the rasterizer as they are, which only draws their part inside the
+        // window. The others are clipped in clip space against the frustum planes their
+        // vertices are outside of, which may discard the triangle or split it into several
+        // new ones, and the clipped triangles are projected instead.
+        triangle_t trianglesAfterClipping[MAX_NUM_POLY_TRIANGLES];
+        int numberTrianglesAfterClipping = 0;
+        int planeMask = outcodes[0] | outcodes[1] | outcodes[2];
+
+        if (!(planeMask & OUTCODE_NEAR_FAR))
+        {
             for (size_t v = 0; v < 3; v++)
             {
-                vector4_t transformedVertice = vector3to4(faceVertices[v]);
-                transformedVertice = matrix4MultiplyVector4(&transformMatrix, &transformedVertice);
-                transformedVertice = matrix4MultiplyVector4(&viewMatrix, &transformedVertice);
-                transformedVertices[v] = transformedVertice;
+                trianglesAfterClipping[0].points[v] = screenVertices[indices[v]];
             }
+        }
 
-            // --- 3b. Back-face Culling ---
-            // Checks if the triangle is facing away from the camera and discards it if so.
-            vector3_t verticesForBackCulling[3] = {
-                vector4to3(transformedVertices[0]),
-                vector4to3(transformedVertices[1]),
-                vector4to3(transformedVertices[2])
-            };
-
-            if(getCullingMode() == CULLING_MODE_NONE && !isFaceFacingCamera(camera.position, verticesForBackCulling)) continue;
-
-            // --- 3c. Clipping ---
-            // Clips the triangle against the 6 planes of the view frustum. This may result
-            // in the triangle being discarded or converted into multiple new triangles.
+        if (planeMask == 0 || (!(planeMask & OUTCODE_NEAR_FAR) && isInsideGuardBand(view, trianglesAfterClipping[0].points)))
+        {
+            trianglesAfterClipping[0].textureCoordinates[0] = face.aUV;
+            trianglesAfterClipping[0].textureCoordinates[1] = face.bUV;
+            trianglesAfterClipping[0].textureCoordinates[2] = face.cUV;
+            numberTrianglesAfterClipping = 1;
+            numberAccepted++;
+        }
+        else
+        {
             polygon_t polygon = createPolygonFromTriangle(
-                vector4to3(transformedVertices[0]),
-                vector4to3(transformedVertices[1]),
-                vector4to3(transformedVertices[2]),
+                clipVertices[0],
+                clipVertices[1],
+                clipVertices[2],
                 face.aUV,
                 face.bUV,
                 face.cUV
             );
-            
-            clipPolygon(&polygon, frustumPlanes);
 
-            triangle_t trianglesAfterClipping[MAX_NUM_POLY_TRIANGLES];
-            int numberTrianglesAfterClipping = 0;
+            clipPolygon(&polygon, planeMask);
 
             trianglesFromPolygon(&polygon, trianglesAfterClipping, &numberTrianglesAfterClipping);
 
-            // --- 3d. Projection & Screen Mapping ---
-            // For each triangle that survived clipping, this block projects it to the screen.
-            for (int t = 0; t < numberTrianglesAfterClipping; t++) {
-                triangle_t triangleAfterClipping = trianglesAfterClipping[t];
+            for (int t = 0; t < numberTrianglesAfterClipping; t++)
+            {
+                for (size_t v = 0; v < 3; v++)
+                {
+                    trianglesAfterClipping[t].points[v] = projectToView(view, &trianglesAfterClipping[t].points[v]);
+                }
+            }
 
-                triangle_t triangle;
+            numberClipped++;
+        }
 
-                for (size_t v = 0; v < 3; v++)
+        // --- 3e. Lighting & Final Assembly ---
+        // Calculates the color of each triangle that survived clipping based on light
+        // intensity and assembles the final triangle data to be sent to the rasterizer.
+        reserveTrianglesToRender(numberTrianglesAfterClipping);
+
+        for (int t = 0; t < numberTrianglesAfterClipping; t++) {
+            triangle_t triangle = trianglesAfterClipping[t];
+
+            vector3_t verticesForIntensityFactor[3] = {
+                vector4to3(transformedVertices[0]),
+                vector4to3(transformedVertices[1]),
+                vector4to3(transformedVertices[2])
+            };
+            
+            const float intensityFactor = lightIntensityFactor(light.direction, verticesForIntensityFactor);
+            triangle.color = lightApplyIntensity(color, intensityFactor);
+
+            triangle.texture = mesh->texture;
+
+            trianglesToRender[numberTrianglesToRender] = triangle;
+            numberTrianglesToRender++;
+        }
+    }
+
+    statsAdd(STAT_ACCEPTED_TRIANGLES, numberAccepted);
+    statsAdd(STAT_REJECTED_TRIANGLES, numberRejected);
+    statsAdd(STAT_CLIPPED_TRIANGLES, numberClipped);
+}
+
+// Processes a mesh drawn as instances, for every view its instances' box is not outside of
+// (`frustumTests`, one FrustumTest per view). Returns how many instances were processed
+// for how many views.
+// Each view culls the instances' bounding spheres all at once (see `cullSpheres`), and the
+// instances seen by any view are then processed like meshes: an instance only crossing a
+// view's frustum is tested again by its bounding box, and one still seen is processed for
+// every view that sees it, with the instance's matrix. Everything computed from the
+// mesh itself, its transform, bounding volumes and the instances' matrices and spheres, is
+// shared by all the instances.
+//
+// Math: the instances' spheres are in the mesh's space, so each view's world-space planes are
+// moved into it instead of moving every sphere into the world. A world point is M * x, with M
+// the mesh's transform, so its distance to a plane p is p · (M * x) = (Mᵀ * p) · x: the plane
+// in the mesh's space is Mᵀ * p, and gives the same distances as p. Rotation and translation
+// keep distances, so a sphere of radius r in the mesh's space is no larger than r * s in the
+// world, with s the largest of the mesh's scale factors. Dividing the planes by s compares
+// the distances with r * s while the spheres keep their radius r.
+int processMeshInstances(const mesh_t* mesh, const matrix4_t* transformMatrix, const int* frustumTests)
+{
+    const int numInstances = getNumberMeshInstances(mesh);
+    const float largestScale = fmax(fabs(mesh->scale.x), fmax(fabs(mesh->scale.y), fabs(mesh->scale.z)));
+    int numberProcessed = 0;
+
+    reserveVisibility(&instanceVisibility, numInstances);
+
+    for (int i = 0; i < numberViews; i++)
+    {
+        if (frustumTests[i] == FRUSTUM_OUTSIDE) continue;
+
+        int numberFound = numInstances;
+
+        if (frustumTests[i] == FRUSTUM_INSIDE)
+        {
+            // Every instance is inside the box, so inside the frustum too.
+            for (int k = 0; k < numInstances; k++)
+            {
+                instanceVisibility.viewIndices[k] = k;
+                instanceVisibility.viewFrustumTests[k] = FRUSTUM_INSIDE;
+            }
+        }
+        else
+        {
+            vector4_t planes[FRUSTUM_NUM_PLANES];
+
+            for (int p = 0; p < FRUSTUM_NUM_PLANES; p++)
+            {
+                const vector4_t plane = views[i].frustumPlanes[p];
+                float coefficients[4];
+
+                for (int j = 0; j < 4; j++)
                 {
-                    // Applies projection matrix and performs viewport transformation to screen coordinates.
-                    vector4_t projectedVertex = matrix4MultiplyVector4Project(&projectionMatrix, &triangleAfterClipping.points[v]);
-                    
-                    projectedVertex.x *= getWindowWidth() / 2.0;
-                    projectedVertex.y *= getWindowHeight() / 2.0;
-
-                    projectedVertex.y *= -1;
-                    
-                    projectedVertex.x += getWindowWidth() / 2.0;
-                    projectedVertex.y += getWindowHeight() / 2.0;
-
-                    triangle.points[v].x = projectedVertex.x;
-                    triangle.points[v].y = projectedVertex.y;
-                    triangle.points[v].z = projectedVertex.z;
-                    triangle.points[v].w = projectedVertex.w;
+                    coefficients[j] = (plane.x * transformMatrix->m[0][j] + plane.y * transformMatrix->m[1][j]
+                        + plane.z * transformMatrix->m[2][j] + plane.w * transformMatrix->m[3][j]) / largestScale;
                 }
 
-                // --- 3e. Lighting & Final Assembly ---
-                // Calculates the triangle's color based on light intensity and assembles the
-                // final triangle data to be sent to the rasterizer.
-                vector3_t verticesForIntensityFactor[3] = {
-                    vector4to3(transformedVertices[0]),
-                    vector4to3(transformedVertices[1]),
-                    vector4to3(transformedVertices[2])
-                };
-                
-                const float intensityFactor = lightIntensityFactor(light.direction, verticesForIntensityFactor);
-                triangle.color = lightApplyIntensity(0xFFFFFFFF, intensityFactor);
-
-                triangle.textureCoordinates[0] = triangleAfterClipping.textureCoordinates[0];
-                triangle.textureCoordinates[1] = triangleAfterClipping.textureCoordinates[1];
-                triangle.textureCoordinates[2] = triangleAfterClipping.textureCoordinates[2];
-
-                if(numberTrianglesToRender > MAX_TRIANGLES) break;
-                
-                trianglesToRender[numberTrianglesToRender] = triangle;
-                numberTrianglesToRender++;
+                planes[p] = (vector4_t){ coefficients[0], coefficients[1], coefficients[2], coefficients[3] };
+            }
+
+            numberFound = cullSpheres(
+                planes,
+                mesh->instanceCenterX, mesh->instanceCenterY, mesh->instanceCenterZ, mesh->instanceRadius,
+                numInstances, instanceVisibility.viewIndices, instanceVisibility.viewFrustumTests
+            );
+        }
+
+        addViewVisibility(&instanceVisibility, i, numberFound);
+    }
+
+    sortVisibility(&instanceVisibility);
+
+    for (int v = 0; v < instanceVisibility.numberVisible; v++)
+    {
+        const int k = instanceVisibility.visible[v];
+        matrix4_t instanceMatrix = matrix4MultiplyAffine(transformMatrix, &mesh->instanceMatrices[k]);
+        int* instanceTests = instanceVisibility.frustumTests[k];
+
+        for (int i = 0; i < numberViews; i++)
+        {
+            if (instanceTests[i] == FRUSTUM_INTERSECTS)
+            {
+                matrix4_t clipMatrix = matrix4MultiplyMatrix4(&views[i].viewProjectionMatrix, &instanceMatrix);
+                instanceTests[i] = classifyBox(&clipMatrix, mesh->boundsMin, mesh->boundsMax);
             }
+
+            if (instanceTests[i] == FRUSTUM_OUTSIDE) continue;
+
+            processMeshView(mesh, &instanceMatrix, &views[i], instanceTests[i], mesh->instances[k].tint);
+            numberProcessed++;
         }
+
+        clearVisibility(&instanceVisibility, k);
     }
+
+    return numberProcessed;
 }
 
-// Renders the final 2D triangles to the screen.
-// This function is called after the update loop has processed all geometry.
-void render()
+// This is the core of the rendering pipeline, executed once per frame.
+// It processes all game objects from 3D space to 2D screen space triangles.
+void update()
+{
+    // --- 1. Frame Timing ---
+    // Waits for the frame scheduler to pace the frame rate to its target. Headless frames are
+    // rendered as fast as possible, each advancing the scene by exactly one frame at the
+    // default rate, so a run always produces the same frames.
+    float frameTimeSeconds = waitForNextFrame();
+
+    if(getDisplayBackend() == DISPLAY_BACKEND_HEADLESS)
+    {
+        frameTimeSeconds = 1.0f / DEFAULT_FRAME_RATE;
+    }
+
+    // --- 2. Object & Camera Updates ---
+    // Updates object transformations (position, rotation, scale).
+    // Creates the views based on the camera's current position and orientation.
+    float rotationIncrement = 1 * frameTimeSeconds;
+
+    cube->position = (vector3_t){ 0, 0, 30 };
+    // cube.rotation = vector3Sum( cube.rotation, (vector3_t){ rotationIncrement, rotationIncrement, rotationIncrement } );
+    cube->scale = (vector3_t){ 2, 2, 2};
+
+    piramid->position = (vector3_t){ 0, 10, 30 };
+    // piramid.rotation = vector3Sum( piramid.rotation, (vector3_t){ 0, rotationIncrement, 0 } );
+    piramid->scale = (vector3_t){ 2, 2, 2 };
+
+    // Every view follows the camera.
+    layoutViews();
+
+    const int numMeshes = getNumberMeshes();
+    numberTrianglesToRender = 0;
+
+    // --- 3. Culling ---
+    // What is computed from the meshes' instances is updated for those that changed. The
+    // scene's bounding volume hierarchy is then refit around the meshes that moved, and walked
+    // once per view to find the meshes whose world bounds touch the view's frustum, without
+    // visiting the groups of meshes that it skips.
+    for (int m = 0; m < numMeshes; m++)
+    {
+        updateMeshInstances(getMesh(m));
+    }
+
+    updateSceneBvh();
+    reserveVisibility(&meshVisibility, numMeshes);
+
+    for (int i = 0; i < numberViews; i++)
+    {
+        const int numberFound = cullSceneBvh(views[i].frustumPlanes, meshVisibility.viewIndices, meshVisibility.viewFrustumTests);
+        addViewVisibility(&meshVisibility, i, numberFound);
+    }
+
+    sortVisibility(&meshVisibility);
+
+    // --- 4. Geometry Processing Loop (per-mesh, per-view) ---
+    // This loop iterates through the meshes found by the views. A mesh whose world box only
+    // crosses a view's frustum is tested again by its own, tighter bounding volumes, and its
+    // triangles are then processed for every view that still sees it. A mesh with instances
+    // is processed once per instance instead, after culling the instances.
+    int numberMeshViews = 0;
+    int numberInstanceViews = 0;
+    int numberInstances = 0;
+
+    for (int m = 0; m < numMeshes; m++)
+    {
+        numberInstances += getNumberMeshInstances(getMesh(m));
+    }
+
+    for (int v = 0; v < meshVisibility.numberVisible; v++)
+    {
+        const int m = meshVisibility.visible[v];
+        mesh_t* mesh = getMesh(m);
+        matrix4_t transformMatrix = getMeshTransformMatrix(mesh);
+        int* frustumTests = meshVisibility.frustumTests[m];
+        bool isVisible = false;
+
+        for (int i = 0; i < numberViews; i++)
+        {
+            if (frustumTests[i] == FRUSTUM_INTERSECTS) frustumTests[i] = classifyMeshView(mesh, &transformMatrix, &views[i]);
+            if (frustumTests[i] != FRUSTUM_OUTSIDE)
+            {
+                isVisible = true;
+                numberMeshViews++;
+            }
+        }
+
+        if (isVisible && mesh->instances != NULL)
+        {
+            numberInstanceViews += processMeshInstances(mesh, &transformMatrix, frustumTests);
+        }
+        else if (isVisible)
+        {
+            for (int i = 0; i < numberViews; i++)
+            {
+                if (frustumTests[i] != FRUSTUM_OUTSIDE) processMeshView(mesh, &transformMatrix, &views[i], frustumTests[i], 0xFFFFFFFF);
+            }
+        }
+
+        clearVisibility(&meshVisibility, m);
+    }
+
+    statsAdd(STAT_CULLED_MESHES, numMeshes * numberViews - numberMeshViews);
+    statsAdd(STAT_CULLED_INSTANCES, numberInstances * numberViews - numberInstanceViews);
+}
+
+// Renders one screen tile: the part of the frame inside the current clip rectangle.
+// Called by the tile renderer on one of the render threads, with the indices of the
+// triangles that overlap the tile in their original drawing order.
+void renderTile(const int* triangleIndices, int numberTriangles)
 {
     // --- 1. Clear Buffers ---
-    // Resets the color and depth buffers for the new frame.
+    // Resets the color and depth buffers of this tile for the new frame.
     clearColorBuffer(0x000000FF);
     clearDepthBuffer();
 
     drawGrid(40, 0x333333FF);
 
-    // --- 2. Rasterization Loop ---
-    // Iterates through the array of screen-space triangles and draws them based on the
+    // --- 2. Depth Pre-pass ---
+    // In depth pre-pass mode, the depth of every triangle is drawn first, so the textured
+    // pass below only shades the pixels that end up visible.
+    if(shouldRenderDepthPrepass())
+    {
+        for (size_t i = 0; i < numberTriangles; i++)
+        {
+            triangle_t triangle = trianglesToRender[triangleIndices[i]];
+
+            drawTriangleDepth(
+                triangle.points[0].x,
+                triangle.points[0].y,
+                triangle.points[0].z,
+                triangle.points[0].w,
+                triangle.points[1].x,
+                triangle.points[1].y,
+                triangle.points[1].z,
+                triangle.points[1].w,
+                triangle.points[2].x,
+                triangle.points[2].y,
+                triangle.points[2].z,
+                triangle.points[2].w
+            );
+        }
+    }
+
+    // --- 3. Visibility Buffer ---
+    // In visibility buffer mode, the triangles only write their index and depth, and the
+    // visible pixels are textured afterwards in a single pass over the tile.
+    if(shouldRenderVisibilityBuffer())
+    {
+        clearVisibilityBuffer();
+
+        for (size_t i = 0; i < numberTriangles; i++)
+        {
+            triangle_t triangle = trianglesToRender[triangleIndices[i]];
+
+            drawTriangleVisibility(
+                triangle.points[0].x,
+                triangle.points[0].y,
+                triangle.points[0].z,
+                triangle.points[0].w,
+                triangle.points[1].x,
+                triangle.points[1].y,
+                triangle.points[1].z,
+                triangle.points[1].w,
+                triangle.points[2].x,
+                triangle.points[2].y,
+                triangle.points[2].z,
+                triangle.points[2].w,
+                triangleIndices[i]
+            );
+        }
+
+        resolveVisibilityBuffer();
+    }
+
+    // --- 4. Rasterization Loop ---
+    // Iterates through the tile's screen-space triangles and draws them based on the
     // current rendering mode (e.g., wireframe, filled, textured).
-    for (size_t i = 0; i < numberTrianglesToRender; i++)
+    const textureImage_t* previousTexture = NULL;
+    int textureSwitches = 0;
+
+    for (size_t i = 0; i < numberTriangles; i++)
     {
-        triangle_t triangle = trianglesToRender[i];
+        triangle_t triangle = trianglesToRender[triangleIndices[i]];
 
         if(shouldRenderVertex())
         {
@@ -360,7 +915,14 @@ void render()
 
         if(shouldRenderTextures())
         {
-            drawTexturedTriangle(
+            texturedTriangleFunction drawTextured = shouldRenderDepthPrepass()
+                ? drawTexturedTriangleEqualDepth
+                : drawTexturedTriangle;
+
+            if (i > 0 && triangle.texture != previousTexture) textureSwitches++;
+            previousTexture = triangle.texture;
+
+            drawTextured(
                 triangle.points[0].x,
                 triangle.points[0].y,
                 triangle.points[0].z,
@@ -379,7 +941,7 @@ void render()
                 triangle.points[2].w,
                 triangle.textureCoordinates[2].u,
                 triangle.textureCoordinates[2].v,
-                texture
+                triangle.texture
             );
         }
 
@@ -396,28 +958,175 @@ void render()
             );
         }
     }
-    
+
+    statsAdd(STAT_TEXTURE_SWITCHES, textureSwitches);
+}
+
+// Renders the final 2D triangles to the screen.
+// This function is called after the update loop has processed all geometry.
+void render()
+{
+    // --- 1. Binning ---
+    // Sorts the triangles into the screen tiles they overlap.
+    binTriangles(trianglesToRender, numberTrianglesToRender);
+
+    // The visibility buffer resolve looks triangles up by index from any tile, so they
+    // are all prepared up front.
+    if(shouldRenderVisibilityBuffer())
+    {
+        setupVisibilityBuffer(trianglesToRender, numberTrianglesToRender);
+    }
+
+    // --- 2. Tile Rendering ---
+    // Every tile is cleared and rasterized by one of the render threads, straight into the
+    // display texture when it can be locked.
+    Uint64 lockStart = SDL_GetPerformanceCounter();
+    lockColorBuffer();
+    Uint64 lockTime = SDL_GetPerformanceCounter() - lockStart;
+
+    renderTiles(renderTile);
+
     // --- 3. Present Frame ---
-    // Copies the software color buffer to the screen, making the new frame visible.
+    // Hands the color buffer to the display (unlocking or copying it), making the new frame visible.
+    Uint64 presentStart = SDL_GetPerformanceCounter();
     renderColorBuffer();
+    Uint64 presentTime = lockTime + SDL_GetPerformanceCounter() - presentStart;
+
+    statsAdd(STAT_PRESENT_MICROSECONDS, (int)(presentTime * 1000000 / SDL_GetPerformanceFrequency()));
 }
 
+// Counts the frame and starts a new measurement period of the rendering counters once per
+// second, printing the finished one first when enabled with `--stats`.
+void reportStats()
+{
+    statsAdd(STAT_FRAMES, 1);
+
+    if (SDL_GetTicks() - previousStatsTicks < 1000) return;
+
+    if (shouldPrintStats) printStats();
+
+    resetStats();
+    previousStatsTicks = SDL_GetTicks();
+}
+
+// Frame callback of headless runs: writes the last frame to the file named by `userData`
+// as a binary PPM image. Headless frames are RGBA8888, and the alpha is dropped.
+void saveFrame(const uint32_t* pixels, int width, int height, int pitch, void* userData)
+{
+    const char* filename = userData;
+
+    if (renderedFrames != headlessFrames - 1) return;
+
+    FILE* file = fopen(filename, "wb");
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "could not write %s\n", filename);
+        return;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            uint32_t pixel = pixels[y * pitch + x];
+            uint8_t rgb[3] = { pixel >> 24, pixel >> 16, pixel >> 8 };
+            fwrite(rgb, 1, 3, file);
+        }
+    }
+
+    fclose(file);
+}
 
 // The main entry point of the application.
 // It contains the main game loop that drives the entire program.
-int main()
+// `--threads N` sets how many threads rasterize the frame (default: one per CPU core).
+// `--stats` prints the rendering counters once per second.
+// `--no-atlas` keeps every mesh on its own texture instead of packing them into an atlas.
+// `--size WxH` sets the window size in pixels (default: 800x600).
+// `--copy-present` draws frames into a separate buffer that is copied to the display texture,
+// instead of drawing straight into the locked texture.
+// `--headless N` renders N frames without opening a window (or reading input) and exits.
+// `--mode N` selects the render mode of a headless run, numbered like the keys (default: 5).
+// `--output FILE` writes the last frame of a headless run to FILE as a PPM image.
+// `--fps N` sets the target frame rate (default: 60), and `--uncapped` renders frames as
+// fast as possible, to measure throughput with `--stats`.
+// `--depth reversed` stores reversed-Z float depths, and `--depth 16` 16-bit depths (default:
+// 32-bit float 1 - 1/w).
+// `--views stereo` renders a stereo pair side by side, and `--views cube` the six faces of a
+// cube map around the camera (default: a single view).
+// `--objects N` adds N instances of the cube on a grid to the scene, to measure how it scales
+// with objects, and `--object-spacing S` sets the distance between them (default: 6).
+int main(int argc, char* argv[])
 {
+    int numberThreads = 0;
+    int width, height;
+    const char* outputFilename = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) numberThreads = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--stats") == 0) shouldPrintStats = true;
+        if (strcmp(argv[i], "--no-atlas") == 0) shouldBuildAtlas = false;
+        if (strcmp(argv[i], "--copy-present") == 0) setZeroCopyPresent(false);
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2
+            && width > 0 && height > 0)
+        {
+            setWindowSize(width, height);
+        }
+        if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc) headlessFrames = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) headlessRenderMode = atoi(argv[i + 1]) - 1;
+        if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) outputFilename = argv[i + 1];
+        if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) setTargetFrameRate(atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--uncapped") == 0) setTargetFrameRate(0);
+        if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+        {
+            if (strcmp(argv[i + 1], "reversed") == 0) setDepthFormat(DEPTH_FORMAT_REVERSED_FLOAT, Z_NEAR);
+            if (strcmp(argv[i + 1], "16") == 0) setDepthFormat(DEPTH_FORMAT_UNORM16, Z_NEAR);
+        }
+        if (strcmp(argv[i], "--views") == 0 && i + 1 < argc)
+        {
+            if (strcmp(argv[i + 1], "stereo") == 0) viewLayout = VIEW_LAYOUT_STEREO;
+            if (strcmp(argv[i + 1], "cube") == 0) viewLayout = VIEW_LAYOUT_CUBE;
+        }
+        if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) numberExtraObjects = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--object-spacing") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) extraObjectSpacing = atof(argv[i + 1]);
+    }
+
+    if (headlessRenderMode < RENDER_MODE_VERTEX || headlessRenderMode > RENDER_MODE_TEXTURED_VISIBILITY)
+    {
+        headlessRenderMode = RENDER_MODE_TEXTURED;
+    }
+
+    if (headlessFrames > 0)
+    {
+        setDisplayBackend(DISPLAY_BACKEND_HEADLESS);
+        setTargetFrameRate(0);
+        if (outputFilename != NULL) setFrameCallback(saveFrame, (void*)outputFilename);
+    }
+
     initializeWindow(&isRunning); 
+    initializeTiles(numberThreads);
     setupScene();
 
+    previousStatsTicks = SDL_GetTicks();
+    startFrameScheduler();
+
     while (isRunning)
     {
-        processInput();
+        if (getDisplayBackend() == DISPLAY_BACKEND_WINDOW) processInput();
         update();
         render();
+        reportStats();
+
+        renderedFrames++;
+        if (headlessFrames > 0 && renderedFrames == headlessFrames) isRunning = false;
     }
 
     clearScene();
+    destroyTiles();
     destroyWindow();
 
     return 0;
@@ -1,22 +1,7 @@
-#include <stddef.h>
 #include <math.h>
 #include <stdio.h>
 #include "matrix.h"
-
-// Creates a 4x4 identity matrix:
-// |1 0 0 0|
-// |0 1 0 0|
-// |0 0 1 0|
-// |0 0 0 1|
-matrix4_t matrix4Identity()
-{
-    return (matrix4_t){{
-        {1, 0, 0, 0},
-        {0, 1, 0, 0},
-        {0, 0, 1, 0},
-        {0, 0, 0, 1}
-    }};
-}
+#include "simd.h"
 
 // Creates a scale matrix by placing scale factors on the diagonal:
 // |sx  0  0  0|
@@ -138,8 +123,8 @@ matrix4_t matrix4MakeRotation(const vector3_t* rotation)
     rz.m[1][1] = cz;
 
     // Combine rotations: R = Rz * Ry * Rx
-    matrix = matrix4MultiplyMatrix4(&rz, &ry);
-    matrix = matrix4MultiplyMatrix4(&matrix, &rx);
+    matrix = matrix4MultiplyAffine(&rz, &ry);
+    matrix = matrix4MultiplyAffine(&matrix, &rx);
     
     return matrix;
 }
@@ -161,83 +146,85 @@ matrix4_t matrix4MakePerspective(float fov, float aspect, float near, float far)
     return matrix;
 }
 
-// Multiplies a matrix by a vector using dot product:
-// For each row of the matrix, compute:
-// result[i] = row[i].x * vector.x + row[i].y * vector.y + 
-//             row[i].z * vector.z + row[i].w * vector.w
-vector4_t matrix4MultiplyVector4(const matrix4_t* matrix, const vector4_t* vector)
+// Transforms `count` points (x, y, z, 1), stored as a structure of arrays, by a matrix: the
+// batch version of `matrix4MultiplyVector4`, which stays the reference for a single point.
+// The results are written as separate arrays of coordinates too; `outW` may be NULL when the
+// matrix is affine, whose results all have w = 1.
+// Every array holds `count` floats, a multiple of 8, and starts on a 32-byte boundary (see
+// `allocateVertexStream`), so the points are loaded and stored SIMD_LANES at a time
+// with aligned vector instructions and no scalar leftovers.
+//
+// Math: row i of the matrix gives coordinate i of every point as
+// m[i][0] * x + m[i][1] * y + m[i][2] * z + m[i][3], with the same matrix element for all of
+// them. Each element is broadcast to every lane once, and a lane holds one point, so a vector
+// multiply-add computes that term for SIMD_LANES points at once. The terms are added in
+// the same order as `matrix4MultiplyVector4`.
+void matrix4TransformPoints(
+    const matrix4_t* matrix,
+    const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW,
+    int count
+)
 {
-    vector4_t result = {0};
-
-    result.x = matrix->m[0][0] * vector->x;
-    result.x += matrix->m[0][1] * vector->y;
-    result.x += matrix->m[0][2] * vector->z;
-    result.x += matrix->m[0][3] * vector->w;
-
-    result.y = matrix->m[1][0] * vector->x;
-    result.y += matrix->m[1][1] * vector->y;
-    result.y += matrix->m[1][2] * vector->z;
-    result.y += matrix->m[1][3] * vector->w;
-
-    result.z = matrix->m[2][0] * vector->x;
-    result.z += matrix->m[2][1] * vector->y;
-    result.z += matrix->m[2][2] * vector->z;
-    result.z += matrix->m[2][3] * vector->w;
-
-    result.w = matrix->m[3][0] * vector->x;
-    result.w += matrix->m[3][1] * vector->y;
-    result.w += matrix->m[3][2] * vector->z;
-    result.w += matrix->m[3][3] * vector->w;
-    
-    return result;
-}
-
-// Multiplies two matrices using row-column multiplication:
-// For each element [i][j] in result matrix:
-// result[i][j] = sum(matrix1[i][k] * matrix2[k][j]) for k = 0 to 3
-matrix4_t matrix4MultiplyMatrix4(const matrix4_t* matrix1, const matrix4_t* matrix2)
-{
-    matrix4_t matrix = matrix4Identity();
+    float* outputs[4] = { outX, outY, outZ, outW };
+    const int numRows = outW != NULL ? 4 : 3;
 
-    for (size_t row = 0; row < 4; row++)
+#if SIMD_LANES == 8
+    for (int p = 0; p < count; p += SIMD_LANES)
     {
-        for (size_t column = 0; column < 4; column++)
+        __m256 px = _mm256_load_ps(&x[p]);
+        __m256 py = _mm256_load_ps(&y[p]);
+        __m256 pz = _mm256_load_ps(&z[p]);
+
+        for (int i = 0; i < numRows; i++)
         {
-            float value = matrix1->m[row][0] * matrix2->m[0][column];
-            value += matrix1->m[row][1] * matrix2->m[1][column];
-            value += matrix1->m[row][2] * matrix2->m[2][column];
-            value += matrix1->m[row][3] * matrix2->m[3][column];
+            __m256 result = _mm256_mul_ps(_mm256_set1_ps(matrix->m[i][0]), px);
+            result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_set1_ps(matrix->m[i][1]), py));
+            result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_set1_ps(matrix->m[i][2]), pz));
+            result = _mm256_add_ps(result, _mm256_set1_ps(matrix->m[i][3]));
 
-            matrix.m[row][column] = value;
+            _mm256_store_ps(&outputs[i][p], result);
         }
     }
-    
-    return matrix;
-}
+#elif SIMD_LANES == 4
+    for (int p = 0; p < count; p += SIMD_LANES)
+    {
+        __m128 px = _mm_load_ps(&x[p]);
+        __m128 py = _mm_load_ps(&y[p]);
+        __m128 pz = _mm_load_ps(&z[p]);
 
-// Performs perspective projection and divides by w component
-// This creates normalized device coordinates (-1 to 1)
-// The w-divide is what creates the perspective effect
-vector4_t matrix4MultiplyVector4Project(const matrix4_t* projection, const vector4_t* vector)
-{
-    vector4_t result = matrix4MultiplyVector4(projection, vector);
+        for (int i = 0; i < numRows; i++)
+        {
+            __m128 result = _mm_mul_ps(_mm_set1_ps(matrix->m[i][0]), px);
+            result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(matrix->m[i][1]), py));
+            result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(matrix->m[i][2]), pz));
+            result = _mm_add_ps(result, _mm_set1_ps(matrix->m[i][3]));
 
-    if (result.w != 0.0f) {
-        result.x /= result.w;
-        result.y /= result.w;
-        result.z /= result.w;
+            _mm_store_ps(&outputs[i][p], result);
+        }
     }
+#else
+    for (int i = 0; i < numRows; i++)
+    {
+        const float m0 = matrix->m[i][0], m1 = matrix->m[i][1], m2 = matrix->m[i][2], m3 = matrix->m[i][3];
+        float* output = outputs[i];
 
-    return result;
+        for (int p = 0; p < count; p++)
+        {
+            output[p] = m0 * x[p] + m1 * y[p] + m2 * z[p] + m3;
+        }
+    }
+#endif
 }
 
 // Combines scale, rotation, and translation matrices in TRS order
 // Final matrix = Translation * Rotation * Scale
 // This order ensures proper transformation hierarchy
+// All three are affine, so they are concatenated as such.
 matrix4_t matrix4TRS(const matrix4_t* scale, const matrix4_t* rotation, const matrix4_t* translation)
 {
-    matrix4_t matrix = matrix4MultiplyMatrix4(rotation, scale);
-    matrix = matrix4MultiplyMatrix4(translation, &matrix);
+    matrix4_t matrix = matrix4MultiplyAffine(rotation, scale);
+    matrix = matrix4MultiplyAffine(translation, &matrix);
     return matrix;
 }
 
@@ -3,12 +3,203 @@
 
 #include "vector.h"
 
+// The matrix products are defined here, `static inline`, like the vector functions: they are
+// called for every mesh, instance and view, several times each. They use SSE when the build
+// targets it (every x86_64 CPU has it), one row of 4 floats per register, and plain C
+// otherwise. Both add up the products in the same order.
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#define MATRIX_SSE 1
+#else
+#define MATRIX_SSE 0
+#endif
+
 typedef struct
 {
     float m[4][4];
 } matrix4_t;
 
-matrix4_t matrix4Identity();
+// Creates a 4x4 identity matrix:
+// |1 0 0 0|
+// |0 1 0 0|
+// |0 0 1 0|
+// |0 0 0 1|
+static inline matrix4_t matrix4Identity()
+{
+    return (matrix4_t){{
+        {1, 0, 0, 0},
+        {0, 1, 0, 0},
+        {0, 0, 1, 0},
+        {0, 0, 0, 1}
+    }};
+}
+
+// Multiplies a matrix by a vector using dot product:
+// For each row of the matrix, compute:
+// result[i] = row[i].x * vector.x + row[i].y * vector.y +
+//             row[i].z * vector.z + row[i].w * vector.w
+// With SSE, each row is multiplied by the vector at once, and the four products are
+// transposed so that adding the registers adds up every row's products.
+static inline vector4_t matrix4MultiplyVector4(const matrix4_t* matrix, const vector4_t* vector)
+{
+    vector4_t result = {0};
+
+#if MATRIX_SSE
+    __m128 v = _mm_loadu_ps(&vector->x);
+    __m128 row0 = _mm_mul_ps(_mm_loadu_ps(matrix->m[0]), v);
+    __m128 row1 = _mm_mul_ps(_mm_loadu_ps(matrix->m[1]), v);
+    __m128 row2 = _mm_mul_ps(_mm_loadu_ps(matrix->m[2]), v);
+    __m128 row3 = _mm_mul_ps(_mm_loadu_ps(matrix->m[3]), v);
+
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+    _mm_storeu_ps(&result.x, _mm_add_ps(_mm_add_ps(_mm_add_ps(row0, row1), row2), row3));
+#else
+    result.x = matrix->m[0][0] * vector->x;
+    result.x += matrix->m[0][1] * vector->y;
+    result.x += matrix->m[0][2] * vector->z;
+    result.x += matrix->m[0][3] * vector->w;
+
+    result.y = matrix->m[1][0] * vector->x;
+    result.y += matrix->m[1][1] * vector->y;
+    result.y += matrix->m[1][2] * vector->z;
+    result.y += matrix->m[1][3] * vector->w;
+
+    result.z = matrix->m[2][0] * vector->x;
+    result.z += matrix->m[2][1] * vector->y;
+    result.z += matrix->m[2][2] * vector->z;
+    result.z += matrix->m[2][3] * vector->w;
+
+    result.w = matrix->m[3][0] * vector->x;
+    result.w += matrix->m[3][1] * vector->y;
+    result.w += matrix->m[3][2] * vector->z;
+    result.w += matrix->m[3][3] * vector->w;
+#endif
+
+    return result;
+}
+
+// Multiplies an affine matrix (one whose last row is 0 0 0 1, like every transform but the
+// projection) by a point, as a 4x3 matrix: the last row and the point's w = 1 are implied,
+// which saves the 7 operations that would only compute w = 1.
+// result[i] = row[i].x * point.x + row[i].y * point.y + row[i].z * point.z + row[i].w
+static inline vector3_t matrix4MultiplyPointAffine(const matrix4_t* matrix, const vector3_t* point)
+{
+    return (vector3_t){
+        matrix->m[0][0] * point->x + matrix->m[0][1] * point->y + matrix->m[0][2] * point->z + matrix->m[0][3],
+        matrix->m[1][0] * point->x + matrix->m[1][1] * point->y + matrix->m[1][2] * point->z + matrix->m[1][3],
+        matrix->m[2][0] * point->x + matrix->m[2][1] * point->y + matrix->m[2][2] * point->z + matrix->m[2][3]
+    };
+}
+
+// Multiplies two matrices using row-column multiplication:
+// For each element [i][j] in result matrix:
+// result[i][j] = sum(matrix1[i][k] * matrix2[k][j]) for k = 0 to 3
+// Row i of the result is the sum of the rows k of matrix2 scaled by matrix1[i][k], which SSE
+// computes a whole row at a time.
+static inline matrix4_t matrix4MultiplyMatrix4(const matrix4_t* matrix1, const matrix4_t* matrix2)
+{
+    matrix4_t matrix;
+
+#if MATRIX_SSE
+    const __m128 rows[4] = {
+        _mm_loadu_ps(matrix2->m[0]),
+        _mm_loadu_ps(matrix2->m[1]),
+        _mm_loadu_ps(matrix2->m[2]),
+        _mm_loadu_ps(matrix2->m[3])
+    };
+
+    for (int row = 0; row < 4; row++)
+    {
+        __m128 value = _mm_mul_ps(_mm_set1_ps(matrix1->m[row][0]), rows[0]);
+        value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(matrix1->m[row][1]), rows[1]));
+        value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(matrix1->m[row][2]), rows[2]));
+        value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(matrix1->m[row][3]), rows[3]));
+
+        _mm_storeu_ps(matrix.m[row], value);
+    }
+#else
+    for (int row = 0; row < 4; row++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            float value = matrix1->m[row][0] * matrix2->m[0][column];
+            value += matrix1->m[row][1] * matrix2->m[1][column];
+            value += matrix1->m[row][2] * matrix2->m[2][column];
+            value += matrix1->m[row][3] * matrix2->m[3][column];
+
+            matrix.m[row][column] = value;
+        }
+    }
+#endif
+
+    return matrix;
+}
+
+// Concatenates two affine matrices (see `matrix4MultiplyPointAffine`), such as a view matrix
+// and a model transform. The product of affine matrices is affine, so only its first three
+// rows are computed, each from the first three rows of matrix2 plus the translation of
+// matrix1: 36 multiplications instead of 64.
+// result[i][j] = sum(matrix1[i][k] * matrix2[k][j]) for k = 0 to 2, plus matrix1[i][3] when j = 3
+static inline matrix4_t matrix4MultiplyAffine(const matrix4_t* matrix1, const matrix4_t* matrix2)
+{
+    matrix4_t matrix;
+
+#if MATRIX_SSE
+    const __m128 rows[3] = {
+        _mm_loadu_ps(matrix2->m[0]),
+        _mm_loadu_ps(matrix2->m[1]),
+        _mm_loadu_ps(matrix2->m[2])
+    };
+
+    for (int row = 0; row < 3; row++)
+    {
+        __m128 value = _mm_mul_ps(_mm_set1_ps(matrix1->m[row][0]), rows[0]);
+        value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(matrix1->m[row][1]), rows[1]));
+        value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(matrix1->m[row][2]), rows[2]));
+        value = _mm_add_ps(value, _mm_set_ps(matrix1->m[row][3], 0, 0, 0));
+
+        _mm_storeu_ps(matrix.m[row], value);
+    }
+#else
+    for (int row = 0; row < 3; row++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            float value = matrix1->m[row][0] * matrix2->m[0][column];
+            value += matrix1->m[row][1] * matrix2->m[1][column];
+            value += matrix1->m[row][2] * matrix2->m[2][column];
+            if (column == 3) value += matrix1->m[row][3];
+
+            matrix.m[row][column] = value;
+        }
+    }
+#endif
+
+    matrix.m[3][0] = 0;
+    matrix.m[3][1] = 0;
+    matrix.m[3][2] = 0;
+    matrix.m[3][3] = 1;
+
+    return matrix;
+}
+
+// Performs perspective projection and divides by w component
+// This creates normalized device coordinates (-1 to 1)
+// The w-divide is what creates the perspective effect
+static inline vector4_t matrix4MultiplyVector4Project(const matrix4_t* projection, const vector4_t* vector)
+{
+    vector4_t result = matrix4MultiplyVector4(projection, vector);
+
+    if (result.w != 0.0f) {
+        result.x /= result.w;
+        result.y /= result.w;
+        result.z /= result.w;
+    }
+
+    return result;
+}
+
 matrix4_t matrix4MakeScale(const vector3_t* scale);
 matrix4_t matrix4MakeTranslation(const vector3_t* translation);
 matrix4_t matrix4MakeRotationX(float angle);
@@ -16,10 +207,13 @@ matrix4_t matrix4MakeRotationY(float angle);
 matrix4_t matrix4MakeRotationZ(float angle);
 matrix4_t matrix4MakeRotation(const vector3_t* rotation);
 matrix4_t matrix4MakePerspective(float fov, float aspect, float near, float far);
-vector4_t matrix4MultiplyVector4(const matrix4_t* matrix, const vector4_t* vector);
-matrix4_t matrix4MultiplyMatrix4(const matrix4_t* matrix1, const matrix4_t* matrix2);
-vector4_t matrix4MultiplyVector4Project(const matrix4_t* projection, const vector4_t* vector);
+void matrix4TransformPoints(
+    const matrix4_t* matrix,
+    const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW,
+    int count
+);
 matrix4_t matrix4TRS(const matrix4_t* scale, const matrix4_t* rotation, const matrix4_t* translation);
 matrix4_t matrix4LookAt(const vector3_t* eye, const vector3_t* target, const vector3_t* up);
 
-#endif
\ No newline at end of file
+#endif
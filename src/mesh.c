@@ -1,39 +1,273 @@
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "mesh.h"
 #include "matrix.h"
 #include "obj.h"
 
-#define MAX_MESHES 10
-
-static mesh_t meshes[MAX_MESHES];
-static int meshCount = 0;
+// The scene's meshes, as a growing array of pointers: a mesh never moves once loaded, so the
+// pointers returned by `loadMesh` stay valid however many meshes are added after it.
+static mesh_t** meshes = NULL;
 
 // Loads a mesh from a file, initializes its transformation properties, and adds it to the scene.
-// This function is part of the asset loading stage, preparing geometric data before rendering.
+// This function is part of the asset loading stage, preparing geometric data before rendering,
+// including the bounding volumes used to cull the whole mesh.
 // It sets the mesh's initial position, rotation, and scale to default values, which correspond
 // to an identity transformation (no change in position, orientation, or size).
 mesh_t* loadMesh(char* filename)
 {
-    loadMeshFromObj(&meshes[meshCount], filename);
+    mesh_t* mesh = malloc(sizeof(mesh_t));
+
+    loadMeshFromObj(mesh, filename);
+    computeMeshBounds(mesh);
+
+    mesh->vertexX = NULL;
+    mesh->vertexY = NULL;
+    mesh->vertexZ = NULL;
+    updateMeshVertexStreams(mesh);
     
-    meshes[meshCount].position = (vector3_t){ 0, 0, 0 };
-    meshes[meshCount].rotation = (vector3_t){ 0, 0, 0 };
-    meshes[meshCount].scale = (vector3_t){ 1, 1, 1 };
+    mesh->texture = NULL;
+    mesh->position = (vector3_t){ 0, 0, 0 };
+    mesh->rotation = (vector3_t){ 0, 0, 0 };
+    mesh->scale = (vector3_t){ 1, 1, 1 };
 
-    mesh_t* mesh = &meshes[meshCount];
+    mesh->instances = NULL;
+    mesh->instanceMatrices = NULL;
+    mesh->instanceCenterX = NULL;
+    mesh->instanceCenterY = NULL;
+    mesh->instanceCenterZ = NULL;
+    mesh->instanceRadius = NULL;
+    mesh->instancesMin = (vector3_t){ 0, 0, 0 };
+    mesh->instancesMax = (vector3_t){ 0, 0, 0 };
+    mesh->isInstancesDirty = false;
+    mesh->instancesRevision = 0;
 
-    meshCount++;
+    array_push(meshes, mesh);
 
     return mesh;
 }
 
+// Computes the object-space bounding box and bounding sphere of a mesh's vertices.
+// Called by `loadMesh`, and again by anything that edits the vertices afterwards. The bounds
+// let the renderer cull a whole mesh against a view frustum with a handful of tests instead
+// of transforming and testing every face.
+//
+// Math:
+// 1. The box is the per-axis minimum and maximum of the vertices.
+// 2. The sphere is centered on the box and reaches the farthest vertex from that center, which
+//    is never larger than the box's half-diagonal and often smaller.
+void computeMeshBounds(mesh_t* mesh)
+{
+    const int numVertices = array_length(mesh->vertices);
+
+    mesh->boundsMin = (vector3_t){ 0, 0, 0 };
+    mesh->boundsMax = (vector3_t){ 0, 0, 0 };
+    mesh->boundingCenter = (vector3_t){ 0, 0, 0 };
+    mesh->boundingRadius = 0;
+
+    if (numVertices == 0) return;
+
+    mesh->boundsMin = mesh->vertices[0];
+    mesh->boundsMax = mesh->vertices[0];
+
+    for (int v = 1; v < numVertices; v++)
+    {
+        vector3_t vertex = mesh->vertices[v];
+
+        if (vertex.x < mesh->boundsMin.x) mesh->boundsMin.x = vertex.x;
+        if (vertex.y < mesh->boundsMin.y) mesh->boundsMin.y = vertex.y;
+        if (vertex.z < mesh->boundsMin.z) mesh->boundsMin.z = vertex.z;
+        if (vertex.x > mesh->boundsMax.x) mesh->boundsMax.x = vertex.x;
+        if (vertex.y > mesh->boundsMax.y) mesh->boundsMax.y = vertex.y;
+        if (vertex.z > mesh->boundsMax.z) mesh->boundsMax.z = vertex.z;
+    }
+
+    mesh->boundingCenter = (vector3_t){
+        (mesh->boundsMin.x + mesh->boundsMax.x) / 2,
+        (mesh->boundsMin.y + mesh->boundsMax.y) / 2,
+        (mesh->boundsMin.z + mesh->boundsMax.z) / 2
+    };
+
+    for (int v = 0; v < numVertices; v++)
+    {
+        float distance = vector3Magnitude(vector3Sub(mesh->vertices[v], mesh->boundingCenter));
+        if (distance > mesh->boundingRadius) mesh->boundingRadius = distance;
+    }
+}
+
+// Allocates a vertex stream: an array of floats for `numVertices` vertices, padded to a
+// multiple of VERTEX_STREAM_PADDING, aligned to as many floats and zeroed. Freed with `free`.
+float* allocateVertexStream(int numVertices)
+{
+    const size_t size = sizeof(float) * paddedVertexCount(numVertices > 0 ? numVertices : 1);
+    float* stream = aligned_alloc(sizeof(float) * VERTEX_STREAM_PADDING, size);
+
+    memset(stream, 0, size);
+
+    return stream;
+}
+
+// Copies the vertices of a mesh into its vertex streams: a structure of arrays, with the x,
+// y and z coordinates of all the vertices in separate arrays. Called by `loadMesh`, and again
+// by anything that edits the vertices afterwards.
+// Transforming vertices one vector4_t at a time uses a quarter of a 4-wide vector at best.
+// Stored as streams, the same coordinate of consecutive vertices is contiguous in memory, so
+// the batch kernels (see `matrix4TransformPoints`) load 4 or 8 vertices' x coordinates with a
+// single instruction, and transform that many vertices with every instruction.
+void updateMeshVertexStreams(mesh_t* mesh)
+{
+    const int numVertices = array_length(mesh->vertices);
+
+    free(mesh->vertexX);
+    free(mesh->vertexY);
+    free(mesh->vertexZ);
+
+    mesh->vertexX = allocateVertexStream(numVertices);
+    mesh->vertexY = allocateVertexStream(numVertices);
+    mesh->vertexZ = allocateVertexStream(numVertices);
+
+    for (int v = 0; v < numVertices; v++)
+    {
+        mesh->vertexX[v] = mesh->vertices[v].x;
+        mesh->vertexY[v] = mesh->vertices[v].y;
+        mesh->vertexZ[v] = mesh->vertices[v].z;
+    }
+}
+
+// Computes the world-space axis-aligned box around a mesh's bounding box once transformed by
+// `transformMatrix`, or around all its instances' bounding spheres when it has instances. It
+// contains every vertex of the transformed mesh, but once the mesh is rotated it is larger
+// than the mesh itself.
+//
+// Math: the box's center c is transformed like a point. Each world axis i of the transformed
+// box reaches as far as the transformed half-extents e, projected on it and added up:
+// e'_i = Σ_j |M[i][j]| * e_j.
+void getMeshWorldBounds(const mesh_t* mesh, const matrix4_t* transformMatrix, vector3_t* worldMin, vector3_t* worldMax)
+{
+    const vector3_t boxMin = mesh->instances != NULL ? mesh->instancesMin : mesh->boundsMin;
+    const vector3_t boxMax = mesh->instances != NULL ? mesh->instancesMax : mesh->boundsMax;
+
+    vector3_t center = {
+        (boxMin.x + boxMax.x) / 2,
+        (boxMin.y + boxMax.y) / 2,
+        (boxMin.z + boxMax.z) / 2
+    };
+    float extent[3] = {
+        (boxMax.x - boxMin.x) / 2,
+        (boxMax.y - boxMin.y) / 2,
+        (boxMax.z - boxMin.z) / 2
+    };
+
+    vector3_t worldCenter = matrix4MultiplyPointAffine(transformMatrix, &center);
+    float worldExtent[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        worldExtent[i] = 0;
+
+        for (int j = 0; j < 3; j++)
+        {
+            worldExtent[i] += fabsf(transformMatrix->m[i][j]) * extent[j];
+        }
+    }
+
+    *worldMin = (vector3_t){ worldCenter.x - worldExtent[0], worldCenter.y - worldExtent[1], worldCenter.z - worldExtent[2] };
+    *worldMax = (vector3_t){ worldCenter.x + worldExtent[0], worldCenter.y + worldExtent[1], worldCenter.z + worldExtent[2] };
+}
+
+// Adds an instance to a mesh and returns its index. From the first instance on, the mesh is
+// no longer drawn on its own: it is drawn once per instance, every copy sharing the mesh's
+// vertices, faces and texture, so a crowd or a forest costs one mesh in memory and is loaded
+// once.
+int addMeshInstance(mesh_t* mesh, meshInstance_t instance)
+{
+    array_push(mesh->instances, instance);
+    mesh->isInstancesDirty = true;
+
+    return array_length(mesh->instances) - 1;
+}
+
+// Replaces instance `index` of a mesh, to move it or change its tint.
+void setMeshInstance(mesh_t* mesh, int index, meshInstance_t instance)
+{
+    mesh->instances[index] = instance;
+    mesh->isInstancesDirty = true;
+}
+
+// Returns how many instances a mesh is drawn as, 0 when it is drawn on its own.
+int getNumberMeshInstances(const mesh_t* mesh)
+{
+    return array_length(mesh->instances);
+}
+
+// Brings what is computed from a mesh's instances up to date after they were added or
+// changed: their transform matrices, bounding spheres and the box around them. Called once
+// per frame for every mesh, before the meshes are culled, and does nothing when the instances
+// did not change. The mesh's own bounding sphere is computed once, when it is loaded, and
+// shared by all its instances.
+//
+// Math: like a mesh's transform, an instance's matrix scales, rotates and translates. Its
+// sphere has the mesh's sphere center transformed by the matrix, and the mesh's radius
+// scaled by the largest of the instance's three scale factors.
+void updateMeshInstances(mesh_t* mesh)
+{
+    if (!mesh->isInstancesDirty) return;
+
+    const int numInstances = array_length(mesh->instances);
+
+    mesh->instanceMatrices = realloc(mesh->instanceMatrices, sizeof(matrix4_t) * numInstances);
+    mesh->instanceCenterX = realloc(mesh->instanceCenterX, sizeof(float) * numInstances);
+    mesh->instanceCenterY = realloc(mesh->instanceCenterY, sizeof(float) * numInstances);
+    mesh->instanceCenterZ = realloc(mesh->instanceCenterZ, sizeof(float) * numInstances);
+    mesh->instanceRadius = realloc(mesh->instanceRadius, sizeof(float) * numInstances);
+
+    for (int i = 0; i < numInstances; i++)
+    {
+        const meshInstance_t* instance = &mesh->instances[i];
+        matrix4_t scaleMatrix = matrix4MakeScale(&instance->scale);
+        matrix4_t rotationMatrix = matrix4MakeRotation(&instance->rotation);
+        matrix4_t translationMatrix = matrix4MakeTranslation(&instance->position);
+        mesh->instanceMatrices[i] = matrix4TRS(&scaleMatrix, &rotationMatrix, &translationMatrix);
+
+        vector3_t instanceCenter = matrix4MultiplyPointAffine(&mesh->instanceMatrices[i], &mesh->boundingCenter);
+        float largestScale = fmaxf(fabsf(instance->scale.x), fmaxf(fabsf(instance->scale.y), fabsf(instance->scale.z)));
+        float radius = mesh->boundingRadius * largestScale;
+
+        mesh->instanceCenterX[i] = instanceCenter.x;
+        mesh->instanceCenterY[i] = instanceCenter.y;
+        mesh->instanceCenterZ[i] = instanceCenter.z;
+        mesh->instanceRadius[i] = radius;
+
+        vector3_t sphereMin = { instanceCenter.x - radius, instanceCenter.y - radius, instanceCenter.z - radius };
+        vector3_t sphereMax = { instanceCenter.x + radius, instanceCenter.y + radius, instanceCenter.z + radius };
+
+        if (i == 0)
+        {
+            mesh->instancesMin = sphereMin;
+            mesh->instancesMax = sphereMax;
+            continue;
+        }
+
+        mesh->instancesMin = (vector3_t){
+            fminf(mesh->instancesMin.x, sphereMin.x), fminf(mesh->instancesMin.y, sphereMin.y), fminf(mesh->instancesMin.z, sphereMin.z)
+        };
+        mesh->instancesMax = (vector3_t){
+            fmaxf(mesh->instancesMax.x, sphereMax.x), fmaxf(mesh->instancesMax.y, sphereMax.y), fmaxf(mesh->instancesMax.z, sphereMax.z)
+        };
+    }
+
+    mesh->isInstancesDirty = false;
+    mesh->instancesRevision++;
+}
+
 // Returns the total number of meshes currently loaded in the scene.
 // This is a utility function used in the main rendering loop to iterate through all meshes
 // that need to be processed and drawn in each frame.
 int getNumberMeshes()
 {
-    return meshCount;
+    return array_length(meshes);
 }
 
 // Retrieves a specific mesh from the scene's list by its index.
@@ -41,7 +275,7 @@ int getNumberMeshes()
 // for transformation, culling, and rasterization.
 mesh_t* getMesh(int index)
 {
-    return &meshes[index];
+    return meshes[index];
 }
 
 // Computes the model-to-world transformation matrix for a given mesh.
@@ -67,9 +301,22 @@ matrix4_t getMeshTransformMatrix(const mesh_t* mesh)
 // by releasing the dynamically allocated memory used by the mesh data.
 void freeAllMeshes()
 {
-    for (size_t i = 0; i < meshCount; i++)
+    for (size_t i = 0; i < array_length(meshes); i++)
     {
-        array_free(meshes[i].vertices);
-        array_free(meshes[i].faces);
+        array_free(meshes[i]->vertices);
+        free(meshes[i]->vertexX);
+        free(meshes[i]->vertexY);
+        free(meshes[i]->vertexZ);
+        array_free(meshes[i]->faces);
+        array_free(meshes[i]->instances);
+        free(meshes[i]->instanceMatrices);
+        free(meshes[i]->instanceCenterX);
+        free(meshes[i]->instanceCenterY);
+        free(meshes[i]->instanceCenterZ);
+        free(meshes[i]->instanceRadius);
+        free(meshes[i]);
     }
+
+    array_free(meshes);
+    meshes = NULL;
 }
\ No newline at end of file
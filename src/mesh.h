@@ -1,25 +1,86 @@
 #ifndef MESH
 #define MESH
 
+#include <stdint.h>
+#include <stdbool.h>
 #include "array/array.h"
 #include "vector.h"
 #include "triangle.h"
 #include "matrix.h"
 
+// The vertex streams of a mesh (see `updateMeshVertexStreams`) hold a multiple of
+// VERTEX_STREAM_PADDING vertices, and every stream starts on a boundary of as many floats
+// (32 bytes), so batch kernels process them in full, aligned vectors of 4 or 8 coordinates.
+#define VERTEX_STREAM_PADDING 8
+
+// Returns the number of vertices a stream of `numVertices` vertices is padded to.
+static inline int paddedVertexCount(int numVertices)
+{
+    return (numVertices + VERTEX_STREAM_PADDING - 1) / VERTEX_STREAM_PADDING * VERTEX_STREAM_PADDING;
+}
+
+// One copy of a mesh's geometry drawn with its own transform, placed inside the mesh's space:
+// the mesh's transform moves all its instances together. `tint` is the base color of the
+// instance's faces in the render modes without textures.
+typedef struct {
+    vector3_t position;
+    vector3_t rotation;
+    vector3_t scale;
+    uint32_t tint;
+} meshInstance_t;
+
 // Represents a 3D object in the scene, containing its geometry and transformation data.
 // This is a central data structure for any renderable object in the project.
 typedef struct {
     vector3_t* vertices;
+    // The same vertices as a structure of arrays, one array per coordinate, padded with
+    // vertices at the origin (see VERTEX_STREAM_PADDING).
+    float* vertexX;
+    float* vertexY;
+    float* vertexZ;
     face_t* faces;
+    // The texture applied to every face in the textured render modes, or NULL.
+    const textureImage_t* texture;
+    // Object-space bounding volumes of the vertices, computed by `computeMeshBounds` when
+    // the mesh is loaded: an axis-aligned box, and a sphere around the box's center.
+    vector3_t boundsMin;
+    vector3_t boundsMax;
+    vector3_t boundingCenter;
+    float boundingRadius;
     vector3_t position;
     vector3_t rotation;
     vector3_t scale;
+    // The instances the mesh is drawn as (see `addMeshInstance`), or NULL when it is drawn
+    // once, with its own transform.
+    meshInstance_t* instances;
+    // Computed from `instances` by `updateMeshInstances`, all in the mesh's space: every
+    // instance's transform matrix and bounding sphere (as separate arrays of center
+    // coordinates and radii, to be culled several at a time), and a box around all the spheres.
+    matrix4_t* instanceMatrices;
+    float* instanceCenterX;
+    float* instanceCenterY;
+    float* instanceCenterZ;
+    float* instanceRadius;
+    vector3_t instancesMin;
+    vector3_t instancesMax;
+    // Whether `instances` changed since `updateMeshInstances` last ran, and how many times
+    // they did, for whoever caches anything derived from them.
+    bool isInstancesDirty;
+    int instancesRevision;
 } mesh_t;
 
 mesh_t* loadMesh(char* filename);
+void computeMeshBounds(mesh_t* mesh);
+float* allocateVertexStream(int numVertices);
+void updateMeshVertexStreams(mesh_t* mesh);
 int getNumberMeshes();
 mesh_t* getMesh(int index);
 matrix4_t getMeshTransformMatrix(const mesh_t* mesh);
+int addMeshInstance(mesh_t* mesh, meshInstance_t instance);
+void setMeshInstance(mesh_t* mesh, int index, meshInstance_t instance);
+int getNumberMeshInstances(const mesh_t* mesh);
+void updateMeshInstances(mesh_t* mesh);
+void getMeshWorldBounds(const mesh_t* mesh, const matrix4_t* transformMatrix, vector3_t* worldMin, vector3_t* worldMax);
 void freeAllMeshes();
 
 #endif
\ No newline at end of file
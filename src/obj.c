@@ -52,4 +52,7 @@ void loadMeshFromObj(mesh_t* mesh, char* filename)
             array_push(mesh->faces, face);
         }
     }
+
+    array_free(textures);
+    fclose(file);
 }
\ No newline at end of file
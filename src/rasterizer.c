@@ -0,0 +1,1282 @@
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "rasterizer.h"
+#include "simd.h"
+
+static inline int minInt(int a, int b) { return a < b ? a : b; }
+static inline int maxInt(int a, int b) { return a > b ? a : b; }
+
+// Twice the signed area of the triangle (a, b, p), using integer pixel coordinates.
+// This is the "edge function" of the edge a->b evaluated at p. It is positive when p lies
+// on the inner side of the edge, zero on the edge itself and negative outside.
+// E(p) = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x)
+static int edgeFunction(int ax, int ay, int bx, int by, int px, int py)
+{
+    return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+// Prepares the edge functions and attribute planes of a triangle for rasterization.
+// Returns false when the triangle is degenerate or lies completely outside the clip rectangle.
+// Because the edge functions are always evaluated at absolute pixel coordinates, a pixel gets
+// exactly the same values whatever clip rectangle the triangle is rasterized with.
+//
+// Math:
+// 1. The triangle is made counter-clockwise (positive area) by swapping two vertices if needed.
+// 2. For each edge we compute E(x, y) = A*x + B*y + C. Moving one pixel right adds A and
+//    moving one row down adds B, so the inner loop never multiplies.
+// 3. Edge i is the edge opposite vertex i, so E_i / area is the barycentric weight of vertex i.
+// 4. Top-left fill rule: pixels exactly on an edge are only drawn if the edge is a top or
+//    a left edge. Other edges get a bias of 1, so adjacent triangles never draw a pixel twice.
+// 5. Any attribute interpolated as α*a0 + β*a1 + γ*a2 becomes e0*(a0/area) + e1*(a1/area) + e2*(a2/area),
+//    so the divisions by the area happen once per triangle instead of once per pixel.
+// 6. Moving one pixel right changes e_i by stepX_i, so a plane changes by Σ stepX_i * k_i
+//    (and by Σ stepY_i * k_i per row): these are its constant screen-space gradients.
+bool setupTriangle(
+    triangleSetup_t* setup, const rect_t* clip,
+    const int x[3], const int y[3], const float w[3], const texture_t uv[3],
+    const textureImage_t* texture
+) {
+    int area = edgeFunction(x[0], y[0], x[1], y[1], x[2], y[2]);
+    int order[3] = { 0, 1, 2 };
+
+    if (area == 0) return false;
+
+    if (area < 0)
+    {
+        order[1] = 2;
+        order[2] = 1;
+        area = -area;
+    }
+
+    int vx[3], vy[3];
+    for (int i = 0; i < 3; i++)
+    {
+        vx[i] = x[order[i]];
+        vy[i] = y[order[i]];
+    }
+
+    setup->minX = maxInt(minInt(vx[0], minInt(vx[1], vx[2])), clip->minX);
+    setup->minY = maxInt(minInt(vy[0], minInt(vy[1], vy[2])), clip->minY);
+    setup->maxX = minInt(maxInt(vx[0], maxInt(vx[1], vx[2])), clip->maxX);
+    setup->maxY = minInt(maxInt(vy[0], maxInt(vy[1], vy[2])), clip->maxY);
+
+    if (setup->minX > setup->maxX || setup->minY > setup->maxY) return false;
+
+    float invArea = 1.0f / area;
+    float bias[3];
+    float largestInvW = 0;
+
+    setup->texture = texture;
+    setup->invW[3] = 0;
+    setup->uOverW[3] = 0;
+    setup->vOverW[3] = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        int a = (i + 1) % 3;
+        int b = (i + 2) % 3;
+
+        int stepX = vy[a] - vy[b];
+        int stepY = vx[b] - vx[a];
+        bool isTopLeft = stepX > 0 || (stepX == 0 && stepY > 0);
+
+        bias[i] = isTopLeft ? 0 : 1;
+        setup->stepX[i] = stepX;
+        setup->stepY[i] = stepY;
+        setup->edgeRow[i] = edgeFunction(vx[a], vy[a], vx[b], vy[b], setup->minX, setup->minY) - bias[i];
+
+        float vertexInvW = 1.0f / w[order[i]];
+        if (fabsf(vertexInvW) > largestInvW) largestInvW = fabsf(vertexInvW);
+
+        setup->invW[i] = vertexInvW * invArea;
+        setup->uOverW[i] = uv ? uv[order[i]].u * vertexInvW * invArea : 0;
+        setup->vOverW[i] = uv ? uv[order[i]].v * vertexInvW * invArea : 0;
+
+        setup->invW[3] += bias[i] * setup->invW[i];
+        setup->uOverW[3] += bias[i] * setup->uOverW[i];
+        setup->vOverW[3] += bias[i] * setup->vOverW[i];
+    }
+
+    for (int g = 0; g < 6; g++)
+    {
+        setup->gradients[g] = 0;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        setup->gradients[0] += setup->stepX[i] * setup->invW[i];
+        setup->gradients[1] += setup->stepY[i] * setup->invW[i];
+        setup->gradients[2] += setup->stepX[i] * setup->uOverW[i];
+        setup->gradients[3] += setup->stepY[i] * setup->uOverW[i];
+        setup->gradients[4] += setup->stepX[i] * setup->vOverW[i];
+        setup->gradients[5] += setup->stepY[i] * setup->vOverW[i];
+    }
+
+    // Inside the triangle the float evaluation of 1 - 1/w sums terms no larger than the
+    // largest vertex 1/w, so its rounding error stays within a few ulps of that value.
+    setup->depthMargin = 8 * FLT_EPSILON * (2 + largestInvW);
+
+    return true;
+}
+
+// Per-pixel depth comparisons done by the shading kernels.
+enum DepthTest
+{
+    // Every covered pixel passes (the block is known to be in front of the stored depths).
+    DEPTH_TEST_NONE,
+    // Pixels pass when closer than the stored depth.
+    DEPTH_TEST_LESS,
+    // Pixels pass when exactly at the stored depth (shading after a depth pre-pass). Their
+    // depth is then replaced by SHADED_DEPTH, so no later triangle can pass there again.
+    DEPTH_TEST_EQUAL
+};
+
+// Depth left at pixels already shaded by an equal-depth pass. No triangle can have an
+// infinite depth, so an equal comparison against it always fails.
+#define SHADED_DEPTH INFINITY
+
+// The 16-bit depth format keeps triangle depths within [1, 65534] and reserves the two
+// extremes: 65535 is the clear value and the shaded depth (no triangle can be equal to it),
+// and 0 pads partial chunks (no triangle can be less than or equal to it).
+#define COMPACT_MIN_DEPTH 1
+#define COMPACT_MAX_DEPTH 65534
+#define COMPACT_SHADED_DEPTH 65535
+#define COMPACT_PADDING_DEPTH 0
+
+// How the depth of a pixel is computed from its interpolated 1/w and stored, for the
+// framebuffer's depth format: depth = bias - scale * (1/w), which the 16-bit format then
+// clamps and rounds down to a whole number. Depths are compared as floats in every format.
+typedef struct {
+    float bias;
+    float scale;
+    bool isCompact;
+} depthMapping_t;
+
+// Returns the depth mapping of the framebuffer's depth format (see `DepthFormat`).
+// 1 - near/w is 0 on the near plane and approaches 1 far away; the 16-bit format scales it
+// to [1, 65535) with 1 + 65534 * (1 - near/w) = 65535 - 65534 * near * (1/w).
+static depthMapping_t getDepthMapping(const framebuffer_t* framebuffer)
+{
+    if (framebuffer->depthFormat == DEPTH_FORMAT_REVERSED_FLOAT) return (depthMapping_t){ 0, 1, false };
+
+    if (framebuffer->depthFormat == DEPTH_FORMAT_UNORM16)
+    {
+        return (depthMapping_t){ COMPACT_SHADED_DEPTH, COMPACT_MAX_DEPTH * framebuffer->depthNear, true };
+    }
+
+    return (depthMapping_t){ 1, 1, false };
+}
+
+// Returns the value a depth buffer of the given format is cleared to: farther than any
+// depth a triangle can have.
+float getDepthClearValue(int depthFormat)
+{
+    if (depthFormat == DEPTH_FORMAT_REVERSED_FLOAT) return 0;
+    if (depthFormat == DEPTH_FORMAT_UNORM16) return COMPACT_SHADED_DEPTH;
+
+    return 1;
+}
+
+// Returns the value stored for a depth: the depth itself in the float formats, and the
+// depth clamped and rounded down to a whole number in the 16-bit format.
+static inline double storedDepth(double depth, const depthMapping_t* mapping)
+{
+    if (!mapping->isCompact) return depth;
+
+    return floor(fmin(fmax(depth, COMPACT_MIN_DEPTH), COMPACT_MAX_DEPTH));
+}
+
+// Per-lane inputs of the visibility buffer resolve: the biased edge values and attribute
+// planes of the triangle visible at each of SIMD_LANES adjacent pixels.
+typedef struct {
+    int edges[3][SIMD_LANES];
+    float invW[4][SIMD_LANES];
+    float uOverW[4][SIMD_LANES];
+    float vOverW[4][SIMD_LANES];
+    float gradients[6][SIMD_LANES];
+    const textureImage_t* textures[SIMD_LANES];
+} resolveLanes_t;
+
+// Fills the resolve inputs of the pixels starting at (x, y) from the triangle ids in `ids`.
+// Edge values are evaluated directly at each pixel; being integers, they are exactly the
+// values the incremental traversal reached there. Pixels without a triangle get negative
+// edge values, so they read as uncovered. Returns false when no pixel has a triangle.
+static inline bool loadResolveLanes(
+    resolveLanes_t* lanes, const triangleSetup_t* setups, const uint32_t* ids, int x, int y
+) {
+    bool hasTriangle = false;
+
+    for (int i = 0; i < SIMD_LANES; i++)
+    {
+        if (ids[i] == VISIBILITY_NONE)
+        {
+            for (int k = 0; k < 4; k++)
+            {
+                if (k < 3) lanes->edges[k][i] = -1;
+                lanes->invW[k][i] = 0;
+                lanes->uOverW[k][i] = 0;
+                lanes->vOverW[k][i] = 0;
+            }
+            for (int g = 0; g < 6; g++)
+            {
+                lanes->gradients[g][i] = 0;
+            }
+            lanes->textures[i] = NULL;
+            continue;
+        }
+
+        const triangleSetup_t* setup = &setups[ids[i]];
+        hasTriangle = true;
+
+        for (int k = 0; k < 4; k++)
+        {
+            if (k < 3)
+            {
+                lanes->edges[k][i] = setup->edgeRow[k]
+                    + (x + i - setup->minX) * setup->stepX[k]
+                    + (y - setup->minY) * setup->stepY[k];
+            }
+            lanes->invW[k][i] = setup->invW[k];
+            lanes->uOverW[k][i] = setup->uOverW[k];
+            lanes->vOverW[k][i] = setup->vOverW[k];
+        }
+        for (int g = 0; g < 6; g++)
+        {
+            lanes->gradients[g][i] = setup->gradients[g];
+        }
+        lanes->textures[i] = setup->texture;
+    }
+
+    return hasTriangle;
+}
+
+// Takes the next group of resolve lanes that sample the same texture out of `remaining`
+// (a bit mask of lanes), and returns it as a bit mask, with the texture in `texture`.
+// The lanes of a chunk usually all show the same mesh, so a single group is the common case.
+static inline int nextTextureGroup(const resolveLanes_t* lanes, int* remaining, const textureImage_t** texture)
+{
+    int group = 0;
+
+    *texture = lanes->textures[__builtin_ctz(*remaining)];
+
+    for (int i = 0; i < SIMD_LANES; i++)
+    {
+        if ((*remaining >> i & 1) && lanes->textures[i] == *texture) group |= 1 << i;
+    }
+
+    *remaining &= ~group;
+
+    return group;
+}
+
+// Picks the mip level a pixel samples, from its texture coordinates (u, v), its interpolated
+// 1/w and the triangle's plane gradients. Every kernel uses these same float operations, so
+// a pixel gets the same level whichever path shades it.
+//
+// Math:
+// 1. u = U / W, where U = u/w and W = 1/w are linear in screen space, so moving one pixel
+//    right changes u by du/dx = (dU/dx - u * dW/dx) / W; the same holds for v and for y.
+// 2. Scaled to texels, one pixel step covers sqrt(du² + dv²) texels of the base level along
+//    x, and likewise along y. The larger of the two, ρ, is the pixel's footprint.
+// 3. The level whose texels best match that footprint is round(log2(ρ)) = floor(log2(2ρ²) / 2),
+//    clamped to the chain. floor(log2(x)) of a float is its exponent field minus 127, so
+//    no logarithm (or square root) is ever evaluated.
+static inline int mipLevel(
+    float u, float v, float interpolatedW, const float gradients[6], const textureImage_t* texture
+) {
+    float invW = 1.0f / interpolatedW;
+    float width = texture->width;
+    float height = texture->height;
+
+    float dudx = (gradients[2] - u * gradients[0]) * (invW * width);
+    float dvdx = (gradients[4] - v * gradients[0]) * (invW * height);
+    float dudy = (gradients[3] - u * gradients[1]) * (invW * width);
+    float dvdy = (gradients[5] - v * gradients[1]) * (invW * height);
+
+    float footprintX = dudx * dudx + dvdx * dvdx;
+    float footprintY = dudy * dudy + dvdy * dvdy;
+    float footprint = footprintX > footprintY ? footprintX : footprintY;
+    footprint += footprint;
+
+    int32_t bits;
+    memcpy(&bits, &footprint, sizeof(bits));
+
+    int level = maxInt((bits >> 23) - 127, 0) >> 1;
+
+    return minInt(level, texture->mipLevels - 1);
+}
+
+// Maps a texel coordinate into [0, size) with the texture's wrap mode.
+// Repeating power-of-two sizes only need a bit mask, which also wraps negative coordinates
+// correctly in two's complement; other sizes fall back to a remainder.
+static inline int wrapTexelCoordinate(int coordinate, int size, const textureImage_t* texture)
+{
+    if (texture->wrap == TEXTURE_WRAP_CLAMP) return minInt(maxInt(coordinate, 0), size - 1);
+    if (texture->isPowerOfTwo) return coordinate & (size - 1);
+
+    coordinate %= size;
+
+    return coordinate < 0 ? coordinate + size : coordinate;
+}
+
+// Fetches the texel at texture coordinates (u, v) from one level of a texture's mip chain,
+// wrapping the coordinates to the size of that level. The coordinates are floored rather than
+// truncated, so that a negative u (or v) falls in the texel to its left, as it does past a
+// repeating texture's other edge.
+static inline uint32_t fetchTexel(const textureImage_t* texture, float u, float v, int level)
+{
+    int width = texture->width >> level;
+    int height = texture->height >> level;
+
+    int textureX = wrapTexelCoordinate((int)floorf(u * width), width, texture);
+    int textureY = wrapTexelCoordinate((int)floorf(v * height), height, texture);
+
+    return texture->texels[texture->levelOffsets[level] + tiledTexelIndex(textureX, textureY, texture->levelStrides[level])];
+}
+
+#if SIMD_LANES == 8
+
+// Evaluates an attribute plane for 8 pixels, given their edge values converted to float and
+// the plane coefficients of each lane: ((e0*k0 + e1*k1) + e2*k2) + k3.
+static inline __m256 interpolateLanes(__m256 f0, __m256 f1, __m256 f2, const __m256 k[4])
+{
+    return _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+        _mm256_mul_ps(f0, k[0]),
+        _mm256_mul_ps(f1, k[1])),
+        _mm256_mul_ps(f2, k[2])),
+        k[3]);
+}
+
+// Evaluates one triangle's attribute plane for 8 pixels.
+static inline __m256 interpolatePlane(__m256 f0, __m256 f1, __m256 f2, const float plane[4])
+{
+    const __m256 k[4] = {
+        _mm256_set1_ps(plane[0]), _mm256_set1_ps(plane[1]), _mm256_set1_ps(plane[2]), _mm256_set1_ps(plane[3])
+    };
+
+    return interpolateLanes(f0, f1, f2, k);
+}
+
+// Loads per-lane plane coefficients stored as 4 arrays of 8 lanes.
+static inline void loadPlaneLanes(__m256 k[4], float plane[4][8])
+{
+    for (int i = 0; i < 4; i++)
+    {
+        k[i] = _mm256_loadu_ps(plane[i]);
+    }
+}
+
+// Picks the mip level of 8 pixels, following `mipLevel`.
+// `u` and `v` are the pixels' texture coordinates and `gradients` the triangle's plane gradients.
+static inline __m256i mipLevelLanes(
+    __m256 u, __m256 v, __m256 interpolatedW, const __m256 gradients[6], const textureImage_t* texture
+) {
+    __m256 invW = _mm256_div_ps(_mm256_set1_ps(1.0f), interpolatedW);
+    __m256 width = _mm256_set1_ps(texture->width);
+    __m256 height = _mm256_set1_ps(texture->height);
+
+    __m256 dudx = _mm256_mul_ps(_mm256_sub_ps(gradients[2], _mm256_mul_ps(u, gradients[0])), _mm256_mul_ps(invW, width));
+    __m256 dvdx = _mm256_mul_ps(_mm256_sub_ps(gradients[4], _mm256_mul_ps(v, gradients[0])), _mm256_mul_ps(invW, height));
+    __m256 dudy = _mm256_mul_ps(_mm256_sub_ps(gradients[3], _mm256_mul_ps(u, gradients[1])), _mm256_mul_ps(invW, width));
+    __m256 dvdy = _mm256_mul_ps(_mm256_sub_ps(gradients[5], _mm256_mul_ps(v, gradients[1])), _mm256_mul_ps(invW, height));
+
+    __m256 footprint = _mm256_max_ps(
+        _mm256_add_ps(_mm256_mul_ps(dudx, dudx), _mm256_mul_ps(dvdx, dvdx)),
+        _mm256_add_ps(_mm256_mul_ps(dudy, dudy), _mm256_mul_ps(dvdy, dvdy)));
+    footprint = _mm256_add_ps(footprint, footprint);
+
+    __m256i exponent = _mm256_sub_epi32(_mm256_srai_epi32(_mm256_castps_si256(footprint), 23), _mm256_set1_epi32(127));
+    __m256i level = _mm256_srli_epi32(_mm256_max_epi32(exponent, _mm256_setzero_si256()), 1);
+
+    return _mm256_min_epi32(level, _mm256_set1_epi32(texture->mipLevels - 1));
+}
+
+// Looks up one of a texture's per-level tables (TEXTURE_MAX_MIP_LEVELS = 16 entries) for 8 lanes.
+// Each half of the table fits a register; the permutes only read the low 3 bits of the level,
+// and the half is then picked by the level's fourth bit.
+static inline __m256i lookupLevelLanes(const int table[TEXTURE_MAX_MIP_LEVELS], __m256i level)
+{
+    __m256i low = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)&table[0]), level);
+    __m256i high = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)&table[8]), level);
+
+    return _mm256_blendv_epi8(low, high, _mm256_cmpgt_epi32(level, _mm256_set1_epi32(7)));
+}
+
+// Computes `tiledTexelIndex` for 8 texels, each in a level with its own row length.
+static inline __m256i tiledTexelIndexLanes(__m256i textureX, __m256i textureY, __m256i width)
+{
+    const __m256i tileMask = _mm256_set1_epi32(TEXTURE_TILE_SIZE - 1);
+
+    __m256i tileRow = _mm256_mullo_epi32(_mm256_andnot_si256(tileMask, textureY), width);
+    __m256i tileColumn = _mm256_or_si256(_mm256_andnot_si256(tileMask, textureX), _mm256_and_si256(textureY, tileMask));
+
+    return _mm256_add_epi32(
+        _mm256_add_epi32(tileRow, _mm256_slli_epi32(tileColumn, TEXTURE_TILE_SHIFT)),
+        _mm256_and_si256(textureX, tileMask));
+}
+
+// Fetches the texels of 8 pixels from their interpolated u/w, v/w and 1/w.
+// u and v are recovered with one division by 1/w. Each pixel then picks its mip level from
+// the triangle's `gradients`, and its coordinates are wrapped to the size of that level.
+// Clamped textures and repeating power-of-two textures are wrapped with min/max or masks and
+// read with a single gather of the lanes selected by `mask`; repeating textures of other sizes
+// wrap and fetch each lane with `fetchTexel`, whose coordinates always land inside the level,
+// so unselected lanes are read harmlessly.
+static inline __m256i sampleLanes(
+    __m256 interpolatedU, __m256 interpolatedV, __m256 interpolatedW, const __m256 gradients[6],
+    __m256 mask, const textureImage_t* texture
+) {
+    interpolatedU = _mm256_div_ps(interpolatedU, interpolatedW);
+    interpolatedV = _mm256_div_ps(interpolatedV, interpolatedW);
+
+    __m256i level = mipLevelLanes(interpolatedU, interpolatedV, interpolatedW, gradients, texture);
+
+    if (texture->wrap == TEXTURE_WRAP_REPEAT && !texture->isPowerOfTwo)
+    {
+        float u[8], v[8];
+        int levels[8];
+        uint32_t texels[8];
+        _mm256_storeu_ps(u, interpolatedU);
+        _mm256_storeu_ps(v, interpolatedV);
+        _mm256_storeu_si256((__m256i*)levels, level);
+
+        for (int i = 0; i < 8; i++)
+        {
+            texels[i] = fetchTexel(texture, u[i], v[i], levels[i]);
+        }
+
+        return _mm256_loadu_si256((const __m256i*)texels);
+    }
+
+    __m256i width = _mm256_srlv_epi32(_mm256_set1_epi32(texture->width), level);
+    __m256i height = _mm256_srlv_epi32(_mm256_set1_epi32(texture->height), level);
+
+    // Floored like in `fetchTexel`, so negative coordinates wrap to the right texel.
+    __m256i textureX = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(interpolatedU, _mm256_cvtepi32_ps(width))));
+    __m256i textureY = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(interpolatedV, _mm256_cvtepi32_ps(height))));
+    __m256i lastX = _mm256_sub_epi32(width, _mm256_set1_epi32(1));
+    __m256i lastY = _mm256_sub_epi32(height, _mm256_set1_epi32(1));
+
+    if (texture->wrap == TEXTURE_WRAP_CLAMP)
+    {
+        textureX = _mm256_min_epi32(_mm256_max_epi32(textureX, _mm256_setzero_si256()), lastX);
+        textureY = _mm256_min_epi32(_mm256_max_epi32(textureY, _mm256_setzero_si256()), lastY);
+    }
+    else
+    {
+        textureX = _mm256_and_si256(textureX, lastX);
+        textureY = _mm256_and_si256(textureY, lastY);
+    }
+
+    __m256i index = _mm256_add_epi32(
+        lookupLevelLanes(texture->levelOffsets, level),
+        tiledTexelIndexLanes(textureX, textureY, lookupLevelLanes(texture->levelStrides, level)));
+
+    return _mm256_mask_i32gather_epi32(
+        _mm256_setzero_si256(), (const int*)texture->texels, index, _mm256_castps_si256(mask), 4);
+}
+
+// Returns a lane mask selecting the lanes whose bit is set in `bits`.
+static inline __m256 laneMask(int bits)
+{
+    const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), laneBits), laneBits));
+}
+
+// Depths of 8 lanes from their interpolated 1/w (see `depthMapping_t`).
+static inline __m256 depthLanes(__m256 interpolatedW, const depthMapping_t* mapping)
+{
+    __m256 depth = _mm256_sub_ps(_mm256_set1_ps(mapping->bias), _mm256_mul_ps(_mm256_set1_ps(mapping->scale), interpolatedW));
+    if (!mapping->isCompact) return depth;
+
+    depth = _mm256_max_ps(depth, _mm256_set1_ps(COMPACT_MIN_DEPTH));
+    depth = _mm256_min_ps(depth, _mm256_set1_ps(COMPACT_MAX_DEPTH));
+
+    return _mm256_floor_ps(depth);
+}
+
+// Loads the depths of 8 lanes as floats, widening 16-bit depths.
+static inline __m256 loadDepthLanes(const void* depths, const depthMapping_t* mapping)
+{
+    if (!mapping->isCompact) return _mm256_loadu_ps(depths);
+
+    return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)depths)));
+}
+
+// Stores the depths of 8 lanes, narrowing them back to 16 bits for the 16-bit format.
+static inline void storeDepthLanes(void* depths, __m256 values, const depthMapping_t* mapping)
+{
+    if (!mapping->isCompact)
+    {
+        _mm256_storeu_ps(depths, values);
+        return;
+    }
+
+    __m256i integers = _mm256_cvtps_epi32(values);
+    __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(integers), _mm256_extracti128_si256(integers, 1));
+
+    _mm_storeu_si128((__m128i*)depths, packed);
+}
+
+// Writes `texels` to the lanes of `colors` selected by `mask`.
+static inline void blendColors(uint32_t* colors, __m256i texels, __m256 mask)
+{
+    __m256i oldColors = _mm256_loadu_si256((const __m256i*)colors);
+    __m256i newColors = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(oldColors), _mm256_castsi256_ps(texels), mask));
+
+    _mm256_storeu_si256((__m256i*)colors, newColors);
+}
+
+// Shades 8 horizontally adjacent pixels with AVX2.
+// `e0`..`e2` are the edge values of the first pixel. Coverage, 1/w, UV reconstruction,
+// texel fetch and the depth test are all evaluated for the 8 lanes at once, and the
+// results are merged into the buffers with a blend so uncovered or occluded lanes keep
+// their previous color and depth. When `writeColor` is false only the depth of the passing
+// lanes is written and no texel is fetched at all.
+// Returns the number of pixels that passed.
+static inline int shadeChunk(
+    const triangleSetup_t* setup, int e0, int e1, int e2,
+    uint32_t* colors, void* depths, const depthMapping_t* mapping,
+    int depthTest, bool writeColor, uint32_t color
+) {
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    __m256i edge0 = _mm256_add_epi32(_mm256_set1_epi32(e0), _mm256_mullo_epi32(lane, _mm256_set1_epi32(setup->stepX[0])));
+    __m256i edge1 = _mm256_add_epi32(_mm256_set1_epi32(e1), _mm256_mullo_epi32(lane, _mm256_set1_epi32(setup->stepX[1])));
+    __m256i edge2 = _mm256_add_epi32(_mm256_set1_epi32(e2), _mm256_mullo_epi32(lane, _mm256_set1_epi32(setup->stepX[2])));
+
+    // A lane is covered when the sign bit of all three edge values is clear.
+    __m256 outside = _mm256_castsi256_ps(_mm256_or_si256(edge0, _mm256_or_si256(edge1, edge2)));
+    if (_mm256_movemask_ps(outside) == 0xFF) return 0;
+
+    __m256 f0 = _mm256_cvtepi32_ps(edge0);
+    __m256 f1 = _mm256_cvtepi32_ps(edge1);
+    __m256 f2 = _mm256_cvtepi32_ps(edge2);
+
+    __m256 interpolatedW = interpolatePlane(f0, f1, f2, setup->invW);
+
+    __m256 depth = depthLanes(interpolatedW, mapping);
+    __m256 oldDepth = loadDepthLanes(depths, mapping);
+    __m256 pass = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+    if (depthTest == DEPTH_TEST_LESS) pass = _mm256_cmp_ps(depth, oldDepth, _CMP_LT_OQ);
+    if (depthTest == DEPTH_TEST_EQUAL)
+    {
+        pass = _mm256_cmp_ps(depth, oldDepth, _CMP_EQ_OQ);
+        depth = _mm256_set1_ps(mapping->isCompact ? COMPACT_SHADED_DEPTH : SHADED_DEPTH);
+    }
+
+    // The sign bit of `outside` is set for uncovered lanes, so only the sign bit of `pass` is meaningful.
+    pass = _mm256_andnot_ps(outside, pass);
+
+    int passMask = _mm256_movemask_ps(pass);
+    if (passMask == 0) return 0;
+
+    storeDepthLanes(depths, _mm256_blendv_ps(oldDepth, depth, pass), mapping);
+    if (!writeColor) return __builtin_popcount(passMask);
+
+    __m256i texels = _mm256_set1_epi32(color);
+
+    if (setup->texture)
+    {
+        __m256 gradients[6];
+
+        for (int g = 0; g < 6; g++)
+        {
+            gradients[g] = _mm256_set1_ps(setup->gradients[g]);
+        }
+
+        texels = sampleLanes(
+            interpolatePlane(f0, f1, f2, setup->uOverW),
+            interpolatePlane(f0, f1, f2, setup->vOverW),
+            interpolatedW, gradients, pass, setup->texture);
+    }
+
+    blendColors(colors, texels, pass);
+
+    return __builtin_popcount(passMask);
+}
+
+// Resolves 8 horizontally adjacent pixels of the visibility buffer with AVX2.
+// Every lane can show a different triangle, so the edge values and planes are loaded per
+// lane, but they then go through exactly the same float operations as in `shadeChunk`:
+// each pixel gets the texel the single textured pass would have written.
+// Returns the number of pixels shaded.
+static inline int resolveChunk(
+    const triangleSetup_t* setups, const uint32_t* ids, int x, int y,
+    uint32_t* colors
+) {
+    resolveLanes_t lanes;
+    if (!loadResolveLanes(&lanes, setups, ids, x, y)) return 0;
+
+    __m256i edge0 = _mm256_loadu_si256((const __m256i*)lanes.edges[0]);
+    __m256i edge1 = _mm256_loadu_si256((const __m256i*)lanes.edges[1]);
+    __m256i edge2 = _mm256_loadu_si256((const __m256i*)lanes.edges[2]);
+
+    __m256 covered = _mm256_andnot_ps(
+        _mm256_castsi256_ps(_mm256_or_si256(edge0, _mm256_or_si256(edge1, edge2))),
+        _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+
+    __m256 f0 = _mm256_cvtepi32_ps(edge0);
+    __m256 f1 = _mm256_cvtepi32_ps(edge1);
+    __m256 f2 = _mm256_cvtepi32_ps(edge2);
+    __m256 k[4];
+
+    loadPlaneLanes(k, lanes.invW);
+    __m256 interpolatedW = interpolateLanes(f0, f1, f2, k);
+    loadPlaneLanes(k, lanes.uOverW);
+    __m256 interpolatedU = interpolateLanes(f0, f1, f2, k);
+    loadPlaneLanes(k, lanes.vOverW);
+    __m256 interpolatedV = interpolateLanes(f0, f1, f2, k);
+    __m256 gradients[6];
+
+    for (int g = 0; g < 6; g++)
+    {
+        gradients[g] = _mm256_loadu_ps(lanes.gradients[g]);
+    }
+
+    // Lanes showing triangles without a texture are left black.
+    __m256i texels = _mm256_setzero_si256();
+    int remaining = _mm256_movemask_ps(covered);
+
+    while (remaining)
+    {
+        const textureImage_t* texture;
+        __m256 group = laneMask(nextTextureGroup(&lanes, &remaining, &texture));
+
+        if (texture == NULL) continue;
+
+        __m256i groupTexels = sampleLanes(interpolatedU, interpolatedV, interpolatedW, gradients, group, texture);
+        texels = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(texels), _mm256_castsi256_ps(groupTexels), group));
+    }
+
+    blendColors(colors, texels, covered);
+
+    return __builtin_popcount(_mm256_movemask_ps(covered));
+}
+
+#elif SIMD_LANES == 4
+
+// Evaluates an attribute plane for 4 pixels, given their edge values converted to float and
+// the plane coefficients of each lane: ((e0*k0 + e1*k1) + e2*k2) + k3.
+static inline __m128 interpolateLanes(__m128 f0, __m128 f1, __m128 f2, const __m128 k[4])
+{
+    return _mm_add_ps(_mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(f0, k[0]),
+        _mm_mul_ps(f1, k[1])),
+        _mm_mul_ps(f2, k[2])),
+        k[3]);
+}
+
+// Evaluates one triangle's attribute plane for 4 pixels.
+static inline __m128 interpolatePlane(__m128 f0, __m128 f1, __m128 f2, const float plane[4])
+{
+    const __m128 k[4] = {
+        _mm_set1_ps(plane[0]), _mm_set1_ps(plane[1]), _mm_set1_ps(plane[2]), _mm_set1_ps(plane[3])
+    };
+
+    return interpolateLanes(f0, f1, f2, k);
+}
+
+// Loads per-lane plane coefficients stored as 4 arrays of 4 lanes.
+static inline void loadPlaneLanes(__m128 k[4], float plane[4][4])
+{
+    for (int i = 0; i < 4; i++)
+    {
+        k[i] = _mm_loadu_ps(plane[i]);
+    }
+}
+
+// Picks the mip level of 4 pixels, following `mipLevel`.
+static inline __m128i mipLevelLanes(
+    __m128 u, __m128 v, __m128 interpolatedW, const __m128 gradients[6], const textureImage_t* texture
+) {
+    __m128 invW = _mm_div_ps(_mm_set1_ps(1.0f), interpolatedW);
+    __m128 width = _mm_set1_ps(texture->width);
+    __m128 height = _mm_set1_ps(texture->height);
+
+    __m128 dudx = _mm_mul_ps(_mm_sub_ps(gradients[2], _mm_mul_ps(u, gradients[0])), _mm_mul_ps(invW, width));
+    __m128 dvdx = _mm_mul_ps(_mm_sub_ps(gradients[4], _mm_mul_ps(v, gradients[0])), _mm_mul_ps(invW, height));
+    __m128 dudy = _mm_mul_ps(_mm_sub_ps(gradients[3], _mm_mul_ps(u, gradients[1])), _mm_mul_ps(invW, width));
+    __m128 dvdy = _mm_mul_ps(_mm_sub_ps(gradients[5], _mm_mul_ps(v, gradients[1])), _mm_mul_ps(invW, height));
+
+    __m128 footprint = _mm_max_ps(
+        _mm_add_ps(_mm_mul_ps(dudx, dudx), _mm_mul_ps(dvdx, dvdx)),
+        _mm_add_ps(_mm_mul_ps(dudy, dudy), _mm_mul_ps(dvdy, dvdy)));
+    footprint = _mm_add_ps(footprint, footprint);
+
+    __m128i exponent = _mm_sub_epi32(_mm_srai_epi32(_mm_castps_si128(footprint), 23), _mm_set1_epi32(127));
+    __m128i level = _mm_srli_epi32(_mm_max_epi32(exponent, _mm_setzero_si128()), 1);
+
+    return _mm_min_epi32(level, _mm_set1_epi32(texture->mipLevels - 1));
+}
+
+// Fetches the texels of 4 pixels from their interpolated u/w, v/w and 1/w.
+// The mip levels are picked in vector registers; SSE has no gather instruction (nor
+// per-lane shifts to size each level), so the 4 texels are then fetched individually.
+// Coordinates are always wrapped into their level, so lanes outside `mask` are read
+// harmlessly and discarded by the caller.
+static inline __m128i sampleLanes(
+    __m128 interpolatedU, __m128 interpolatedV, __m128 interpolatedW, const __m128 gradients[6],
+    __m128 mask, const textureImage_t* texture
+) {
+    interpolatedU = _mm_div_ps(interpolatedU, interpolatedW);
+    interpolatedV = _mm_div_ps(interpolatedV, interpolatedW);
+
+    float u[4], v[4];
+    int level[4];
+    _mm_storeu_ps(u, interpolatedU);
+    _mm_storeu_ps(v, interpolatedV);
+    _mm_storeu_si128((__m128i*)level, mipLevelLanes(interpolatedU, interpolatedV, interpolatedW, gradients, texture));
+
+    return _mm_setr_epi32(
+        fetchTexel(texture, u[0], v[0], level[0]),
+        fetchTexel(texture, u[1], v[1], level[1]),
+        fetchTexel(texture, u[2], v[2], level[2]),
+        fetchTexel(texture, u[3], v[3], level[3]));
+}
+
+// Returns a lane mask selecting the lanes whose bit is set in `bits`.
+static inline __m128 laneMask(int bits)
+{
+    const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), laneBits), laneBits));
+}
+
+// Depths of 4 lanes from their interpolated 1/w (see `depthMapping_t`).
+static inline __m128 depthLanes(__m128 interpolatedW, const depthMapping_t* mapping)
+{
+    __m128 depth = _mm_sub_ps(_mm_set1_ps(mapping->bias), _mm_mul_ps(_mm_set1_ps(mapping->scale), interpolatedW));
+    if (!mapping->isCompact) return depth;
+
+    depth = _mm_max_ps(depth, _mm_set1_ps(COMPACT_MIN_DEPTH));
+    depth = _mm_min_ps(depth, _mm_set1_ps(COMPACT_MAX_DEPTH));
+
+    return _mm_floor_ps(depth);
+}
+
+// Loads the depths of 4 lanes as floats, widening 16-bit depths.
+static inline __m128 loadDepthLanes(const void* depths, const depthMapping_t* mapping)
+{
+    if (!mapping->isCompact) return _mm_loadu_ps(depths);
+
+    return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)depths)));
+}
+
+// Stores the depths of 4 lanes, narrowing them back to 16 bits for the 16-bit format.
+static inline void storeDepthLanes(void* depths, __m128 values, const depthMapping_t* mapping)
+{
+    if (!mapping->isCompact)
+    {
+        _mm_storeu_ps(depths, values);
+        return;
+    }
+
+    __m128i integers = _mm_cvtps_epi32(values);
+    _mm_storel_epi64((__m128i*)depths, _mm_packus_epi32(integers, integers));
+}
+
+// Writes `texels` to the lanes of `colors` selected by `mask`.
+static inline void blendColors(uint32_t* colors, __m128i texels, __m128 mask)
+{
+    __m128i oldColors = _mm_loadu_si128((const __m128i*)colors);
+    __m128i newColors = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(oldColors), _mm_castsi128_ps(texels), mask));
+
+    _mm_storeu_si128((__m128i*)colors, newColors);
+}
+
+// Shades 4 horizontally adjacent pixels with SSE4.1.
+// Same pipeline as the AVX2 kernel. Returns the number of pixels that passed.
+static inline int shadeChunk(
+    const triangleSetup_t* setup, int e0, int e1, int e2,
+    uint32_t* colors, void* depths, const depthMapping_t* mapping,
+    int depthTest, bool writeColor, uint32_t color
+) {
+    const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+
+    __m128i edge0 = _mm_add_epi32(_mm_set1_epi32(e0), _mm_mullo_epi32(lane, _mm_set1_epi32(setup->stepX[0])));
+    __m128i edge1 = _mm_add_epi32(_mm_set1_epi32(e1), _mm_mullo_epi32(lane, _mm_set1_epi32(setup->stepX[1])));
+    __m128i edge2 = _mm_add_epi32(_mm_set1_epi32(e2), _mm_mullo_epi32(lane, _mm_set1_epi32(setup->stepX[2])));
+
+    __m128 outside = _mm_castsi128_ps(_mm_or_si128(edge0, _mm_or_si128(edge1, edge2)));
+    if (_mm_movemask_ps(outside) == 0xF) return 0;
+
+    __m128 f0 = _mm_cvtepi32_ps(edge0);
+    __m128 f1 = _mm_cvtepi32_ps(edge1);
+    __m128 f2 = _mm_cvtepi32_ps(edge2);
+
+    __m128 interpolatedW = interpolatePlane(f0, f1, f2, setup->invW);
+
+    __m128 depth = depthLanes(interpolatedW, mapping);
+    __m128 oldDepth = loadDepthLanes(depths, mapping);
+    __m128 pass = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+    if (depthTest == DEPTH_TEST_LESS) pass = _mm_cmplt_ps(depth, oldDepth);
+    if (depthTest == DEPTH_TEST_EQUAL)
+    {
+        pass = _mm_cmpeq_ps(depth, oldDepth);
+        depth = _mm_set1_ps(mapping->isCompact ? COMPACT_SHADED_DEPTH : SHADED_DEPTH);
+    }
+
+    pass = _mm_andnot_ps(outside, pass);
+
+    int passMask = _mm_movemask_ps(pass);
+    if (passMask == 0) return 0;
+
+    storeDepthLanes(depths, _mm_blendv_ps(oldDepth, depth, pass), mapping);
+    if (!writeColor) return __builtin_popcount(passMask);
+
+    __m128i texels = _mm_set1_epi32(color);
+
+    if (setup->texture)
+    {
+        __m128 gradients[6];
+
+        for (int g = 0; g < 6; g++)
+        {
+            gradients[g] = _mm_set1_ps(setup->gradients[g]);
+        }
+
+        texels = sampleLanes(
+            interpolatePlane(f0, f1, f2, setup->uOverW),
+            interpolatePlane(f0, f1, f2, setup->vOverW),
+            interpolatedW, gradients, pass, setup->texture);
+    }
+
+    blendColors(colors, texels, pass);
+
+    return __builtin_popcount(passMask);
+}
+
+// Resolves 4 horizontally adjacent pixels of the visibility buffer with SSE4.1.
+// Same pipeline as the AVX2 resolve. Returns the number of pixels shaded.
+static inline int resolveChunk(
+    const triangleSetup_t* setups, const uint32_t* ids, int x, int y,
+    uint32_t* colors
+) {
+    resolveLanes_t lanes;
+    if (!loadResolveLanes(&lanes, setups, ids, x, y)) return 0;
+
+    __m128i edge0 = _mm_loadu_si128((const __m128i*)lanes.edges[0]);
+    __m128i edge1 = _mm_loadu_si128((const __m128i*)lanes.edges[1]);
+    __m128i edge2 = _mm_loadu_si128((const __m128i*)lanes.edges[2]);
+
+    __m128 covered = _mm_andnot_ps(
+        _mm_castsi128_ps(_mm_or_si128(edge0, _mm_or_si128(edge1, edge2))),
+        _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+    __m128 f0 = _mm_cvtepi32_ps(edge0);
+    __m128 f1 = _mm_cvtepi32_ps(edge1);
+    __m128 f2 = _mm_cvtepi32_ps(edge2);
+    __m128 k[4];
+
+    loadPlaneLanes(k, lanes.invW);
+    __m128 interpolatedW = interpolateLanes(f0, f1, f2, k);
+    loadPlaneLanes(k, lanes.uOverW);
+    __m128 interpolatedU = interpolateLanes(f0, f1, f2, k);
+    loadPlaneLanes(k, lanes.vOverW);
+    __m128 interpolatedV = interpolateLanes(f0, f1, f2, k);
+    __m128 gradients[6];
+
+    for (int g = 0; g < 6; g++)
+    {
+        gradients[g] = _mm_loadu_ps(lanes.gradients[g]);
+    }
+
+    __m128i texels = _mm_setzero_si128();
+    int remaining = _mm_movemask_ps(covered);
+
+    while (remaining)
+    {
+        const textureImage_t* texture;
+        __m128 group = laneMask(nextTextureGroup(&lanes, &remaining, &texture));
+
+        if (texture == NULL) continue;
+
+        __m128i groupTexels = sampleLanes(interpolatedU, interpolatedV, interpolatedW, gradients, group, texture);
+        texels = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(texels), _mm_castsi128_ps(groupTexels), group));
+    }
+
+    blendColors(colors, texels, covered);
+
+    return __builtin_popcount(_mm_movemask_ps(covered));
+}
+
+#else
+
+// Evaluates one of the triangle's attribute planes at a pixel, given its biased edge values.
+static inline float interpolate(const float plane[4], int e0, int e1, int e2)
+{
+    return e0 * plane[0] + e1 * plane[1] + e2 * plane[2] + plane[3];
+}
+
+// Fetches the texel of a pixel from its interpolated u/w, v/w and 1/w, from the mip level
+// picked by `mipLevel`.
+static inline uint32_t sampleTexel(
+    float interpolatedU, float interpolatedV, float interpolatedW, const float gradients[6],
+    const textureImage_t* texture
+) {
+    interpolatedU /= interpolatedW;
+    interpolatedV /= interpolatedW;
+
+    int level = mipLevel(interpolatedU, interpolatedV, interpolatedW, gradients, texture);
+
+    return fetchTexel(texture, interpolatedU, interpolatedV, level);
+}
+
+// Scalar fallback: shades a single pixel.
+// Used on targets without SSE4.1 or AVX2; it performs exactly the same steps as the
+// vector kernels, one pixel at a time. Returns 1 when the pixel passed, 0 otherwise.
+static inline int shadeChunk(
+    const triangleSetup_t* setup, int e0, int e1, int e2,
+    uint32_t* colors, void* depths, const depthMapping_t* mapping,
+    int depthTest, bool writeColor, uint32_t color
+) {
+    if ((e0 | e1 | e2) < 0) return 0;
+
+    float interpolatedW = interpolate(setup->invW, e0, e1, e2);
+    float depth = mapping->bias - mapping->scale * interpolatedW;
+    float oldDepth = mapping->isCompact ? *(uint16_t*)depths : *(float*)depths;
+
+    if (mapping->isCompact) depth = floorf(fminf(fmaxf(depth, COMPACT_MIN_DEPTH), COMPACT_MAX_DEPTH));
+
+    if (depthTest == DEPTH_TEST_LESS && !(depth < oldDepth)) return 0;
+    if (depthTest == DEPTH_TEST_EQUAL && !(depth == oldDepth)) return 0;
+
+    if (mapping->isCompact) *(uint16_t*)depths = depthTest == DEPTH_TEST_EQUAL ? COMPACT_SHADED_DEPTH : depth;
+    else *(float*)depths = depthTest == DEPTH_TEST_EQUAL ? SHADED_DEPTH : depth;
+
+    if (!writeColor) return 1;
+
+    *colors = setup->texture
+        ? sampleTexel(
+            interpolate(setup->uOverW, e0, e1, e2),
+            interpolate(setup->vOverW, e0, e1, e2),
+            interpolatedW, setup->gradients, setup->texture)
+        : color;
+
+    return 1;
+}
+
+// Scalar fallback: resolves a single pixel of the visibility buffer.
+// Returns 1 when the pixel shows a triangle, 0 otherwise.
+static inline int resolveChunk(
+    const triangleSetup_t* setups, const uint32_t* ids, int x, int y,
+    uint32_t* colors
+) {
+    resolveLanes_t lanes;
+    if (!loadResolveLanes(&lanes, setups, ids, x, y)) return 0;
+
+    const triangleSetup_t* setup = &setups[ids[0]];
+    int e0 = lanes.edges[0][0];
+    int e1 = lanes.edges[1][0];
+    int e2 = lanes.edges[2][0];
+
+    if ((e0 | e1 | e2) < 0) return 0;
+
+    // Triangles without a texture are left black.
+    *colors = setup->texture
+        ? sampleTexel(
+            interpolate(setup->uOverW, e0, e1, e2),
+            interpolate(setup->vOverW, e0, e1, e2),
+            interpolate(setup->invW, e0, e1, e2), setup->gradients, setup->texture)
+        : 0;
+
+    return 1;
+}
+
+#endif
+
+// Rasterizes the pixels of one depth block, restricted to the rectangle (x0, y0)-(x1, y1).
+// The block's rows are walked in chunks of SIMD_LANES pixels (8 with AVX2, 4 with SSE4.1,
+// 1 otherwise). The last, partial chunk of a row is copied into a small staging area padded
+// with pixels that always fail the depth test, so it runs through the same kernel as the
+// rest of the row and never reads or writes past the rectangle.
+// Returns the number of pixels that passed the depth test.
+static int rasterizeBlock(
+    const triangleSetup_t* setup, const framebuffer_t* framebuffer, const depthMapping_t* mapping,
+    int x0, int y0, int x1, int y1, const int edges[3],
+    int depthTest, bool writeColor, uint32_t color
+) {
+    size_t depthSize = mapping->isCompact ? sizeof(uint16_t) : sizeof(float);
+    // The padding of the staging area only fails a real comparison.
+    int stagedDepthTest = depthTest == DEPTH_TEST_NONE ? DEPTH_TEST_LESS : depthTest;
+    int passed = 0;
+    int e0Row = edges[0];
+    int e1Row = edges[1];
+    int e2Row = edges[2];
+
+    for (int y = y0; y <= y1; y++)
+    {
+        int e0 = e0Row;
+        int e1 = e1Row;
+        int e2 = e2Row;
+
+        uint32_t* colorRow = &framebuffer->colorBuffer[framebuffer->colorPitch * y];
+        char* depthRow = (char*)framebuffer->depthBuffer + depthSize * framebuffer->width * y;
+
+        int x = x0;
+
+        for (; x + SIMD_LANES - 1 <= x1; x += SIMD_LANES)
+        {
+            passed += shadeChunk(
+                setup, e0, e1, e2, &colorRow[x], &depthRow[depthSize * x], mapping,
+                depthTest, writeColor, color);
+
+            e0 += setup->stepX[0] * SIMD_LANES;
+            e1 += setup->stepX[1] * SIMD_LANES;
+            e2 += setup->stepX[2] * SIMD_LANES;
+        }
+
+        if (x <= x1)
+        {
+            int remaining = x1 - x + 1;
+            uint32_t stagedColors[SIMD_LANES];
+            union {
+                float values[SIMD_LANES];
+                uint16_t compactValues[SIMD_LANES];
+            } stagedDepths;
+
+            for (int i = 0; i < SIMD_LANES; i++)
+            {
+                stagedColors[i] = i < remaining ? colorRow[x + i] : 0;
+
+                if (mapping->isCompact)
+                {
+                    stagedDepths.compactValues[i] = i < remaining ? ((uint16_t*)depthRow)[x + i] : COMPACT_PADDING_DEPTH;
+                }
+                else
+                {
+                    stagedDepths.values[i] = i < remaining ? ((float*)depthRow)[x + i] : -FLT_MAX;
+                }
+            }
+
+            passed += shadeChunk(
+                setup, e0, e1, e2, stagedColors, &stagedDepths, mapping,
+                stagedDepthTest, writeColor, color);
+
+            for (int i = 0; i < remaining; i++)
+            {
+                colorRow[x + i] = stagedColors[i];
+            }
+
+            memcpy(&depthRow[depthSize * x], &stagedDepths, depthSize * remaining);
+        }
+
+        e0Row += setup->stepY[0];
+        e1Row += setup->stepY[1];
+        e2Row += setup->stepY[2];
+    }
+
+    return passed;
+}
+
+// Rasterizes a prepared triangle with a half-space (edge function) traversal.
+// The triangle's bounding box is walked in DEPTH_BLOCK_SIZE x DEPTH_BLOCK_SIZE blocks, and
+// each block is first tested as a whole against the edges and the hierarchical depth buffer
+// before any pixel work is done. When the setup has no texture the triangle is filled with
+// `color`, otherwise every covered pixel is textured.
+//
+// `pass` selects what is tested and written:
+// - RASTER_PASS_COLOR: the regular single pass, color and depth of closer pixels are written;
+// - RASTER_PASS_DEPTH_ONLY: the first pass of a depth pre-pass, only depth is written and no
+//   texel is ever fetched;
+// - RASTER_PASS_EQUAL_DEPTH: the second pass of a depth pre-pass, only pixels whose depth is
+//   exactly the one left by the first pass get their color written. The depth is computed
+//   with the same float operations in both passes, so the comparison is exact. A shaded
+//   pixel's depth is replaced by SHADED_DEPTH, so when several triangles share the visible
+//   depth (e.g. along a silhouette edge) only the first one drawn shades it, exactly as a
+//   single color pass would.
+// Returns the number of pixels that passed the depth test.
+//
+// Math:
+// 1. For perspective-correct interpolation we interpolate 1/w, u/w and v/w, which are
+//    linear in screen space, and recover u and v with one division by the interpolated 1/w.
+// 2. The depth buffer stores a depth that decreases with 1/w (1 - 1/w by default, see
+//    `DepthFormat`): values closer to the camera are smaller. A pixel is only drawn if its
+//    depth is smaller than the value already in the buffer.
+// 3. Edge functions and depth are both linear in screen space, so their extremes over a
+//    rectangle are found at its 4 corners:
+//    - if one edge is negative at all 4 corners, the block is outside the triangle;
+//    - if every edge is non-negative at all 4 corners, the triangle covers the whole block;
+//    - if the nearest depth of the triangle in the block is not closer than the farthest
+//      depth stored in the block, every pixel would fail the depth test: the block is skipped;
+//    - if the farthest depth of the triangle is closer than the nearest depth stored in the
+//      block, every pixel would pass: the per-pixel depth compare is skipped.
+// 4. Corner depths are evaluated in double precision and widened by `depthMargin`, the
+//    largest rounding error of the per-pixel float evaluation (scaled with the depth
+//    mapping), so the block decisions always agree with what the per-pixel test would have
+//    done. The 16-bit format rounds the widened range like the pixels it bounds; rounding
+//    down never puts two depths out of order, so the decisions still hold. An equal-depth pass can only
+//    skip blocks (its nearest depth is farther than the block's farthest, or its farthest is
+//    closer than the block's nearest), and leaves the block ranges untouched: they still
+//    bound every pixel not yet shaded, which are the only ones it can pass.
+int rasterizeTriangle(
+    const triangleSetup_t* setup, const framebuffer_t* framebuffer,
+    int pass, uint32_t color
+) {
+    // A local copy lets the compiler keep the setup in registers, since stores to the
+    // color buffer could otherwise alias it.
+    const triangleSetup_t triangle = *setup;
+    setup = &triangle;
+
+    const depthMapping_t mapping = getDepthMapping(framebuffer);
+    const double depthMargin = setup->depthMargin * fmax(mapping.bias, mapping.scale);
+
+    bool writeColor = pass != RASTER_PASS_DEPTH_ONLY;
+    int passed = 0;
+
+    int firstBlockX = setup->minX / DEPTH_BLOCK_SIZE;
+    int firstBlockY = setup->minY / DEPTH_BLOCK_SIZE;
+    int lastBlockX = setup->maxX / DEPTH_BLOCK_SIZE;
+    int lastBlockY = setup->maxY / DEPTH_BLOCK_SIZE;
+
+    for (int blockY = firstBlockY; blockY <= lastBlockY; blockY++)
+    {
+        int y0 = maxInt(blockY * DEPTH_BLOCK_SIZE, setup->minY);
+        int y1 = minInt(blockY * DEPTH_BLOCK_SIZE + DEPTH_BLOCK_SIZE - 1, setup->maxY);
+
+        for (int blockX = firstBlockX; blockX <= lastBlockX; blockX++)
+        {
+            int x0 = maxInt(blockX * DEPTH_BLOCK_SIZE, setup->minX);
+            int x1 = minInt(blockX * DEPTH_BLOCK_SIZE + DEPTH_BLOCK_SIZE - 1, setup->maxX);
+
+            // Edge values at the 4 corners of the rectangle: (x0, y0), (x1, y0), (x0, y1), (x1, y1).
+            int corners[4][3];
+            bool isOutside = false;
+            bool isCovered = true;
+
+            for (int i = 0; i < 3; i++)
+            {
+                corners[0][i] = setup->edgeRow[i] + (x0 - setup->minX) * setup->stepX[i] + (y0 - setup->minY) * setup->stepY[i];
+                corners[1][i] = corners[0][i] + (x1 - x0) * setup->stepX[i];
+                corners[2][i] = corners[0][i] + (y1 - y0) * setup->stepY[i];
+                corners[3][i] = corners[1][i] + (y1 - y0) * setup->stepY[i];
+
+                int all = corners[0][i] & corners[1][i] & corners[2][i] & corners[3][i];
+                int any = corners[0][i] | corners[1][i] | corners[2][i] | corners[3][i];
+
+                if (all < 0) isOutside = true;
+                if (any < 0) isCovered = false;
+            }
+
+            if (isOutside) continue;
+
+            double nearest = DBL_MAX;
+            double farthest = -DBL_MAX;
+
+            for (int c = 0; c < 4; c++)
+            {
+                double interpolatedW = (double)corners[c][0] * setup->invW[0]
+                    + (double)corners[c][1] * setup->invW[1]
+                    + (double)corners[c][2] * setup->invW[2]
+                    + setup->invW[3];
+                double depth = mapping.bias - mapping.scale * interpolatedW;
+
+                if (depth < nearest) nearest = depth;
+                if (depth > farthest) farthest = depth;
+            }
+
+            nearest = storedDepth(nearest - depthMargin, &mapping);
+            farthest = storedDepth(farthest + depthMargin, &mapping);
+
+            int block = blockY * framebuffer->blocksPerRow + blockX;
+
+            if (pass == RASTER_PASS_EQUAL_DEPTH)
+            {
+                if (nearest > framebuffer->blockMaxDepth[block]) continue;
+                if (farthest < framebuffer->blockMinDepth[block]) continue;
+
+                passed += rasterizeBlock(
+                    setup, framebuffer, &mapping, x0, y0, x1, y1, corners[0],
+                    DEPTH_TEST_EQUAL, writeColor, color);
+                continue;
+            }
+
+            if (nearest >= framebuffer->blockMaxDepth[block]) continue;
+
+            int depthTest = farthest >= framebuffer->blockMinDepth[block] ? DEPTH_TEST_LESS : DEPTH_TEST_NONE;
+
+            passed += rasterizeBlock(
+                setup, framebuffer, &mapping, x0, y0, x1, y1, corners[0],
+                depthTest, writeColor, color);
+
+            // Keep the block bounds conservative: nothing closer than `nearest` was written,
+            // and a fully covered block now holds nothing farther than `farthest`.
+            if (nearest < framebuffer->blockMinDepth[block])
+            {
+                framebuffer->blockMinDepth[block] = nearest;
+            }
+
+            bool isWholeBlock = x1 - x0 == DEPTH_BLOCK_SIZE - 1 && y1 - y0 == DEPTH_BLOCK_SIZE - 1;
+
+            if (isCovered && isWholeBlock && farthest < framebuffer->blockMaxDepth[block])
+            {
+                framebuffer->blockMaxDepth[block] = farthest;
+            }
+        }
+    }
+
+    return passed;
+}
+
+// Shades the visibility buffer inside `rect`: the second pass of deferred texturing.
+// Every pixel of `framebuffer->idBuffer` holds the index of the triangle visible there (or
+// VISIBILITY_NONE), written by a flat pass that rasterized triangle indices as colors.
+// `setups` holds the prepared triangles, indexed by those ids, each with its own texture.
+// Each pixel is textured once, however many triangles covered it, and the rows are walked in
+// chunks of SIMD_LANES pixels like `rasterizeBlock`, with the same padded staging area for
+// the last chunk of a row.
+// Returns the number of pixels shaded.
+//
+// Math:
+// 1. The edge values of a pixel are recomputed from the triangle's setup at absolute pixel
+//    coordinates: E(x, y) = edgeRow + (x - minX) * stepX + (y - minY) * stepY. These are
+//    the biased barycentric numerators the rasterizer had at that pixel.
+// 2. 1/w, u/w and v/w are then evaluated and divided exactly as in the single textured
+//    pass, so the resolved image is identical to it.
+int resolveVisibility(
+    const framebuffer_t* framebuffer, const rect_t* rect,
+    const triangleSetup_t* setups
+) {
+    int shaded = 0;
+
+    for (int y = rect->minY; y <= rect->maxY; y++)
+    {
+        uint32_t* colorRow = &framebuffer->colorBuffer[framebuffer->colorPitch * y];
+        const uint32_t* idRow = &framebuffer->idBuffer[framebuffer->width * y];
+
+        int x = rect->minX;
+
+        for (; x + SIMD_LANES - 1 <= rect->maxX; x += SIMD_LANES)
+        {
+            shaded += resolveChunk(setups, &idRow[x], x, y, &colorRow[x]);
+        }
+
+        if (x <= rect->maxX)
+        {
+            int remaining = rect->maxX - x + 1;
+            uint32_t stagedColors[SIMD_LANES];
+            uint32_t stagedIds[SIMD_LANES];
+
+            for (int i = 0; i < SIMD_LANES; i++)
+            {
+                stagedColors[i] = i < remaining ? colorRow[x + i] : 0;
+                stagedIds[i] = i < remaining ? idRow[x + i] : VISIBILITY_NONE;
+            }
+
+            shaded += resolveChunk(setups, stagedIds, x, y, stagedColors);
+
+            for (int i = 0; i < remaining; i++)
+            {
+                colorRow[x + i] = stagedColors[i];
+            }
+        }
+    }
+
+    return shaded;
+}
@@ -0,0 +1,103 @@
+#ifndef RASTERIZER
+#define RASTERIZER
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "texture.h"
+
+// Side of the square pixel blocks tracked by the hierarchical depth buffer.
+#define DEPTH_BLOCK_SIZE 8
+
+// Visibility buffer value of a pixel no triangle covers.
+#define VISIBILITY_NONE 0xFFFFFFFF
+
+// Formats of the depth buffer. Every format stores a function of the interpolated 1/w that
+// is smaller for pixels closer to the camera, so all of them are tested with "less".
+enum DepthFormat
+{
+    // 32-bit float 1 - 1/w. Float values are densest near 0, but 1 - 1/w is near 1 for
+    // distant pixels, so depth precision is poorest far away.
+    DEPTH_FORMAT_FLOAT,
+    // 32-bit float -1/w: reversed-Z (1/w is the largest close to the camera, and the buffer
+    // is cleared to 0). Distant pixels have small 1/w, where floats are densest, so their
+    // depth keeps the full float precision.
+    DEPTH_FORMAT_REVERSED_FLOAT,
+    // 16-bit unsigned normalized 1 - near/w, on [1, 65534]: half the memory traffic of the
+    // 32-bit formats. It resolves w to about w² / (near * 65534), so it needs a near plane
+    // that is not too close to the camera.
+    DEPTH_FORMAT_UNORM16
+};
+
+// The software render target the rasterizer writes into.
+// All buffers are row-major arrays of `width * height` pixels, except that the rows of the
+// color buffer are `colorPitch` pixels apart (it can be the memory of a locked texture).
+// The depth buffer holds floats or 16-bit integers depending on `depthFormat`; the 16-bit
+// format needs the distance of the near plane, `depthNear`. Alongside the depth buffer,
+// every DEPTH_BLOCK_SIZE x DEPTH_BLOCK_SIZE block keeps a conservative range of the depths
+// stored in it (a hierarchical depth buffer), used to reject or accept whole blocks of a
+// triangle before doing any per-pixel work. The visibility buffer (`idBuffer`) holds the
+// index of the triangle visible at each pixel when rendering with deferred texturing.
+typedef struct {
+    uint32_t* colorBuffer;
+    int colorPitch;
+    void* depthBuffer;
+    int depthFormat;
+    float depthNear;
+    uint32_t* idBuffer;
+    int width;
+    int height;
+    float* blockMinDepth;
+    float* blockMaxDepth;
+    int blocksPerRow;
+} framebuffer_t;
+
+// An inclusive pixel rectangle, used to restrict rasterization to part of the framebuffer.
+typedef struct {
+    int minX, minY, maxX, maxY;
+} rect_t;
+
+// What one rasterization of a triangle tests and writes (see `rasterizeTriangle`).
+enum RasterPass
+{
+    RASTER_PASS_COLOR,
+    RASTER_PASS_DEPTH_ONLY,
+    RASTER_PASS_EQUAL_DEPTH
+};
+
+// Per-triangle state shared by the flat and textured rasterizers.
+// Everything that does not change from pixel to pixel is computed once here, so the
+// inner loop is reduced to integer additions and a handful of multiply-adds.
+typedef struct {
+    // Clip-rectangle-clamped bounding box of the triangle (inclusive).
+    int minX, minY, maxX, maxY;
+    // Edge function values at (minX, minY), already offset by the fill-rule bias.
+    int edgeRow[3];
+    // Per-pixel (x) and per-row (y) increments of each edge function.
+    int stepX[3], stepY[3];
+    // Attribute planes: attribute = e0*k[0] + e1*k[1] + e2*k[2] + k[3], where e0..e2
+    // are the biased edge values of the current pixel.
+    float invW[4];
+    float uOverW[4];
+    float vOverW[4];
+    // Texture sampled at the pixels of a textured triangle, or NULL.
+    const textureImage_t* texture;
+    // Screen-space derivatives of the planes, per pixel to the right (x) and per row down (y):
+    // { d(1/w)/dx, d(1/w)/dy, d(u/w)/dx, d(u/w)/dy, d(v/w)/dx, d(v/w)/dy }. Used to pick mip levels.
+    float gradients[6];
+    // Upper bound of the rounding error of the per-pixel depth, used by the block tests.
+    float depthMargin;
+} triangleSetup_t;
+
+bool setupTriangle(
+    triangleSetup_t* setup, const rect_t* clip,
+    const int x[3], const int y[3], const float w[3], const texture_t uv[3],
+    const textureImage_t* texture);
+float getDepthClearValue(int depthFormat);
+int rasterizeTriangle(
+    const triangleSetup_t* setup, const framebuffer_t* framebuffer,
+    int pass, uint32_t color);
+int resolveVisibility(
+    const framebuffer_t* framebuffer, const rect_t* rect,
+    const triangleSetup_t* setups);
+
+#endif
@@ -0,0 +1,76 @@
+#include <SDL2/SDL.h>
+#include "scheduler.h"
+
+static int targetFrameRate = DEFAULT_FRAME_RATE;
+
+// Frames are scheduled from a start time, on the high-resolution performance counter:
+// frame n may start at `scheduleStart + n * frequency / targetFrameRate`.
+static Uint64 scheduleStart = 0;
+static Uint64 scheduledFrames = 0;
+static Uint64 previousFrameStart = 0;
+
+// Sets how many frames per second the scheduler paces frames to.
+// 0 (or less) uncaps the frame rate: frames are rendered as fast as possible, to measure
+// the renderer's throughput.
+void setTargetFrameRate(int framesPerSecond)
+{
+    targetFrameRate = framesPerSecond > 0 ? framesPerSecond : 0;
+    startFrameScheduler();
+}
+
+// Returns the frames per second the scheduler paces frames to, or 0 when uncapped.
+int getTargetFrameRate()
+{
+    return targetFrameRate;
+}
+
+// Starts the schedule from the current time. Called once before the first frame.
+void startFrameScheduler()
+{
+    scheduleStart = SDL_GetPerformanceCounter();
+    scheduledFrames = 0;
+    previousFrameStart = scheduleStart;
+}
+
+// Waits until the next frame is due and returns the time since the previous frame started,
+// in seconds. Called at the start of every frame.
+// The wait sleeps while more than SCHEDULER_SPIN_MICROSECONDS are left and spins for the rest.
+// Deadlines are multiples of the exact frame period from the start of the schedule, so they
+// neither drift nor accumulate the rounding of a whole number of milliseconds (60 frames
+// per second is 16.67 ms, not 16). A frame that finishes after the next deadline starts the
+// schedule again from now, rather than rushing the following frames to catch up.
+float waitForNextFrame()
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+
+    if (targetFrameRate > 0)
+    {
+        scheduledFrames++;
+
+        Uint64 deadline = scheduleStart + scheduledFrames * frequency / targetFrameRate;
+        Uint64 now = SDL_GetPerformanceCounter();
+
+        if (now >= deadline)
+        {
+            scheduleStart = now;
+            scheduledFrames = 0;
+        }
+        else
+        {
+            Uint64 spinTime = frequency * SCHEDULER_SPIN_MICROSECONDS / 1000000;
+
+            if (deadline - now > spinTime)
+            {
+                SDL_Delay((Uint32)((deadline - now - spinTime) * 1000 / frequency));
+            }
+
+            while (SDL_GetPerformanceCounter() < deadline) {}
+        }
+    }
+
+    Uint64 frameStart = SDL_GetPerformanceCounter();
+    float frameTime = (float)(frameStart - previousFrameStart) / frequency;
+    previousFrameStart = frameStart;
+
+    return frameTime;
+}
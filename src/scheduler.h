@@ -0,0 +1,17 @@
+#ifndef SCHEDULER
+#define SCHEDULER
+
+// Frame rate the scheduler paces frames to unless another one is set.
+#define DEFAULT_FRAME_RATE 60
+
+// Time left before a frame's deadline below which the scheduler stops sleeping and spins
+// on the clock instead. SDL_Delay only has millisecond resolution and can oversleep by a
+// scheduler tick, so the last stretch of every wait is polled to start frames on time.
+#define SCHEDULER_SPIN_MICROSECONDS 2000
+
+void setTargetFrameRate(int framesPerSecond);
+int getTargetFrameRate();
+void startFrameScheduler();
+float waitForNextFrame();
+
+#endif
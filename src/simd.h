@@ -0,0 +1,18 @@
+#ifndef SIMD
+#define SIMD
+
+// Number of floats the widest vector instructions the build targets hold: 8 with AVX2, 4 with
+// SSE4.1, 1 (plain C) otherwise. The rasterizer's pixel kernels, the sphere culling and the
+// batch vertex transform all pick their code path from it, so they always target the same
+// instruction set.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_LANES 8
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define SIMD_LANES 4
+#else
+#define SIMD_LANES 1
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "stats.h"
+
+static SDL_atomic_t counters[STAT_COUNT];
+
+// Adds to one of the rendering counters.
+// Safe to call from any render thread; callers are expected to batch their updates
+// (e.g. once per triangle) rather than count every pixel individually.
+void statsAdd(int stat, int amount)
+{
+    if (amount != 0) SDL_AtomicAdd(&counters[stat], amount);
+}
+
+// Returns the current value of one of the rendering counters.
+int statsGet(int stat)
+{
+    return SDL_AtomicGet(&counters[stat]);
+}
+
+// Sets every counter back to zero, starting a new measurement period.
+void resetStats()
+{
+    for (int i = 0; i < STAT_COUNT; i++)
+    {
+        SDL_AtomicSet(&counters[i], 0);
+    }
+}
+
+// Prints the counters collected since the last reset as averages per frame.
+// The frame count is also the frame rate, so the shaded fragments per second (the raster
+// throughput) are the product of the first two numbers. When shading was deferred (depth pre-pass or visibility buffer), it also reports how many
+// of the fragments a single textured pass would have shaded were removed as overdraw.
+// The triangle counts show how many triangles per frame skipped the clipper, either trivially
+// accepted or rejected by their outcodes, and how many had to be clipped, and the culled
+// meshes how many meshes were skipped whole by their bounding volumes.
+void printStats()
+{
+    int frames = statsGet(STAT_FRAMES);
+    if (frames == 0) return;
+
+    int shaded = statsGet(STAT_SHADED_FRAGMENTS) / frames;
+    int depthPass = statsGet(STAT_DEPTH_PASS_FRAGMENTS) / frames;
+    int textureSwitches = statsGet(STAT_TEXTURE_SWITCHES) / frames;
+    int presentMicroseconds = statsGet(STAT_PRESENT_MICROSECONDS) / frames;
+    int accepted = statsGet(STAT_ACCEPTED_TRIANGLES) / frames;
+    int rejected = statsGet(STAT_REJECTED_TRIANGLES) / frames;
+    int clipped = statsGet(STAT_CLIPPED_TRIANGLES) / frames;
+    int culledMeshes = statsGet(STAT_CULLED_MESHES) / frames;
+    int culledInstances = statsGet(STAT_CULLED_INSTANCES) / frames;
+
+    printf("frames: %d, shaded fragments/frame: %d", frames, shaded);
+
+    if (depthPass > 0)
+    {
+        printf(", overdraw removed: %d fragments/frame (%.1f%%)",
+            depthPass - shaded, 100.0f * (depthPass - shaded) / depthPass);
+    }
+
+    if (textureSwitches > 0)
+    {
+        printf(", texture switches/frame: %d", textureSwitches);
+    }
+
+    printf(", present: %d us/frame", presentMicroseconds);
+
+    printf(", triangles/frame: %d accepted, %d rejected, %d clipped", accepted, rejected, clipped);
+
+    printf(", culled meshes/frame: %d", culledMeshes);
+
+    if (culledInstances > 0)
+    {
+        printf(", culled instances/frame: %d", culledInstances);
+    }
+
+    printf("\n");
+}
@@ -0,0 +1,42 @@
+#ifndef STATS
+#define STATS
+
+// Counters collected while rendering, summed over all render threads.
+enum Stat
+{
+    STAT_FRAMES,
+    // Fragments that passed the depth test and were shaded (textured or filled).
+    STAT_SHADED_FRAGMENTS,
+    // Fragments that passed the depth test in a pass that defers shading: the depth-only
+    // pass of the depth pre-pass, or the index pass of the visibility buffer. This is the
+    // number of fragments a single textured pass would have shaded.
+    STAT_DEPTH_PASS_FRAGMENTS,
+    // Textured triangles drawn with a different texture than the triangle drawn before them
+    // in the same tile. Every switch moves the sampler to texels that are cold in the cache.
+    STAT_TEXTURE_SWITCHES,
+    // Time spent handing finished frames to the display: locking the color buffer texture and
+    // unlocking (or copying into) it, then presenting it.
+    STAT_PRESENT_MICROSECONDS,
+    // Triangles (after back-face culling) sent to the rasterizer without clipping, because
+    // they were inside the view frustum or its guard band.
+    STAT_ACCEPTED_TRIANGLES,
+    // Triangles discarded without clipping, because all their vertices were outside the same
+    // frustum plane.
+    STAT_REJECTED_TRIANGLES,
+    // Triangles clipped against the frustum planes they cross.
+    STAT_CLIPPED_TRIANGLES,
+    // Meshes skipped by a view because their bounding volumes were outside its frustum (a
+    // mesh is counted once per view that skips it).
+    STAT_CULLED_MESHES,
+    // Instances of meshes skipped by a view because their bounding volumes were outside its
+    // frustum (counted once per view that skips them).
+    STAT_CULLED_INSTANCES,
+    STAT_COUNT
+};
+
+void statsAdd(int stat, int amount);
+int statsGet(int stat);
+void resetStats();
+void printStats();
+
+#endif
@@ -1,5 +1,16 @@
 #include <stdlib.h>
+#include <string.h>
 #include "texture.h"
+#include "color.h"
+
+static textureImage_t textures[MAX_TEXTURES];
+static int textureCount = 0;
+
+// Rounds a number of texels up to a whole number of tiles.
+static int roundUpToTile(int texels)
+{
+    return (texels + TEXTURE_TILE_SIZE - 1) & ~(TEXTURE_TILE_SIZE - 1);
+}
 
 uint32_t* convertARGBtoRGBATexture(const uint32_t* src, int numPixels) {
     uint32_t* dst = malloc(numPixels * sizeof(uint32_t));
@@ -12,17 +23,134 @@ uint32_t* convertARGBtoRGBATexture(const uint32_t* src, int numPixels) {
     return dst;
 }
 
-void loadTextureFromPng(const char* filename, upng_t** png, uint32_t** texture)
+// Copies a row-major texture into the tiled layout, with rows of `stride` texels.
+// Texel (x, y) moves from index y * width + x to `tiledTexelIndex(x, y, stride)`. The
+// samplers address textures in this layout, so every texture goes through here once
+// when it is loaded.
+void tileTexture(uint32_t* tiled, const uint32_t* rowMajor, int stride, int width, int height)
 {
-    *png = upng_new_from_file(filename);
-    if (*png != NULL) {
-        upng_decode(*png);
-        if (upng_get_error(*png) == UPNG_EOK) {
-            *texture = (uint32_t*)upng_get_buffer(*png);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            tiled[tiledTexelIndex(x, y, stride)] = rowMajor[y * width + x];
         }
     }
 }
 
+// Averages a 2x2 block of texels, channel by channel.
+static uint32_t averageTexels(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    uint32_t average = 0;
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+        average |= ((sum + 2) / 4) << shift;
+    }
+
+    return average;
+}
+
+// Creates a texture from `width` x `height` row-major texels and adds it to the scene's textures.
+// The tiled mip chain is built here: each level is made by averaging 2x2 blocks of the
+// previous one (a box filter; an odd last row or column is dropped), and the levels are
+// stored one after the other, each with its rows padded to whole tiles.
+// Returns NULL when the scene already holds MAX_TEXTURES textures.
+textureImage_t* createTexture(const uint32_t* texels, int width, int height, int wrap)
+{
+    if (textureCount == MAX_TEXTURES) return NULL;
+
+    textureImage_t* texture = &textures[textureCount];
+    int size = 0;
+
+    texture->width = width;
+    texture->height = height;
+    texture->wrap = wrap;
+    texture->isPowerOfTwo = (width & (width - 1)) == 0 && (height & (height - 1)) == 0;
+    texture->mipLevels = 0;
+
+    // A level is added while it still has at least one tile along its smaller side; the
+    // base level is always there, however small.
+    do {
+        int levelWidth = width >> texture->mipLevels;
+        int levelHeight = height >> texture->mipLevels;
+
+        texture->levelOffsets[texture->mipLevels] = size;
+        texture->levelStrides[texture->mipLevels] = roundUpToTile(levelWidth);
+        size += roundUpToTile(levelWidth) * roundUpToTile(levelHeight);
+        texture->mipLevels++;
+    } while (texture->mipLevels < TEXTURE_MAX_MIP_LEVELS
+        && (width >> texture->mipLevels) >= TEXTURE_TILE_SIZE
+        && (height >> texture->mipLevels) >= TEXTURE_TILE_SIZE);
+
+    texture->texels = calloc(size, sizeof(uint32_t));
+
+    uint32_t* level = malloc(width * height * sizeof(uint32_t));
+
+    for (int i = 0; i < width * height; i++) {
+        level[i] = texels[i];
+    }
+
+    for (int l = 0; l < texture->mipLevels; l++) {
+        int levelWidth = width >> l;
+        int levelHeight = height >> l;
+
+        tileTexture(&texture->texels[texture->levelOffsets[l]], level, texture->levelStrides[l], levelWidth, levelHeight);
+
+        // Downsampled in place: texel (x, y) only reads texels at or after its own index.
+        for (int y = 0; y < levelHeight / 2; y++) {
+            for (int x = 0; x < levelWidth / 2; x++) {
+                const uint32_t* source = &level[(2 * y) * levelWidth + 2 * x];
+                level[y * (levelWidth / 2) + x] = averageTexels(source[0], source[1], source[levelWidth], source[levelWidth + 1]);
+            }
+        }
+    }
+
+    free(level);
+
+    textureCount++;
+
+    return texture;
+}
+
+// Decodes a PNG file and creates a texture from its texels (see `createTexture`).
+// Only 8-bit RGBA images are supported. Returns NULL when the file cannot be read or decoded.
+textureImage_t* loadTextureFromPng(const char* filename, int wrap)
+{
+    textureImage_t* texture = NULL;
+    upng_t* png = upng_new_from_file(filename);
+
+    if (png == NULL) return NULL;
+
+    upng_decode(png);
+
+    if (upng_get_error(png) == UPNG_EOK && upng_get_format(png) == UPNG_RGBA8) {
+        int width = upng_get_width(png);
+        int height = upng_get_height(png);
+
+        // The texels are mapped to the display's format once here, so sampling them
+        // writes pixels the color buffer can present as they are.
+        uint32_t* texels = malloc(sizeof(uint32_t) * width * height);
+        memcpy(texels, upng_get_buffer(png), sizeof(uint32_t) * width * height);
+        mapColors(texels, width * height);
+
+        texture = createTexture(texels, width, height, wrap);
+        free(texels);
+    }
+
+    upng_free(png);
+
+    return texture;
+}
+
+// Frees the mip chains of all the textures created for the scene.
+void freeAllTextures()
+{
+    for (int i = 0; i < textureCount; i++) {
+        free(textures[i].texels);
+    }
+
+    textureCount = 0;
+}
+
 const uint8_t sampleTexture[] = {
     0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff,
     0x54, 0x54, 0x54, 0xff, 0x38, 0x38, 0x38, 0xff, 0x54, 0x54, 0x54, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x54, 0x54, 0x54, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x54, 0x54, 0x54, 0xff, 0x48, 0x48, 0x48, 0xff, 0x38, 0x38, 0x38, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x38, 0x38, 0x38, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x54, 0x54, 0x54, 0xff, 0x54, 0x54, 0x54, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x48, 0x48, 0x48, 0xff, 0x38, 0x38, 0x38, 0xff,
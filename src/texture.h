@@ -2,10 +2,48 @@
 #define TEXTURE
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "png/upng.h"
 
-#define TEXTURE_WIDTH 64
-#define TEXTURE_HEIGHT 64
+// Textures are stored in square tiles of TEXTURE_TILE_SIZE x TEXTURE_TILE_SIZE texels
+// instead of row by row. A 4x4 tile of 32-bit texels is 64 bytes, one cache line, so
+// texels that are close to each other in any direction (not only horizontally) are also
+// close in memory, and a triangle sampled along a column touches 4 times fewer cache lines.
+#define TEXTURE_TILE_SHIFT 2
+#define TEXTURE_TILE_SIZE (1 << TEXTURE_TILE_SHIFT)
+
+// Textures are loaded with a chain of mip levels: the full-size texture followed by copies
+// of half the size of the previous one, until the smaller side is a single tile (a 64x64
+// texture has 5 levels, 64x64 to 4x4 texels). Minified surfaces sample a smaller level, so
+// neighbouring pixels read neighbouring texels. 16 levels cover sides of up to 131072 texels.
+#define TEXTURE_MAX_MIP_LEVELS 16
+
+// Maximum number of textures a scene can create.
+#define MAX_TEXTURES 10
+
+// How texture coordinates outside [0, 1) are mapped back into the texture.
+enum TextureWrap
+{
+    // The texture repeats (tiles) across the surface.
+    TEXTURE_WRAP_REPEAT,
+    // Coordinates are clamped to the edge texels.
+    TEXTURE_WRAP_CLAMP
+};
+
+// A texture image: its tiled mip chain and everything the samplers need to address it.
+// Level l is (width >> l) x (height >> l) texels, stored from texel levelOffsets[l] with
+// rows of levelStrides[l] texels (the width rounded up to whole tiles). When both sides are
+// powers of two, coordinates are wrapped with a bit mask instead of a division.
+typedef struct {
+    uint32_t* texels;
+    int width;
+    int height;
+    int mipLevels;
+    int levelOffsets[TEXTURE_MAX_MIP_LEVELS];
+    int levelStrides[TEXTURE_MAX_MIP_LEVELS];
+    bool isPowerOfTwo;
+    int wrap;
+} textureImage_t;
 
 // Represents a 2D texture coordinate (UV mapping).
 // This struct is used to map a point on a 2D texture to a vertex on a 3D model.
@@ -19,8 +57,29 @@ typedef struct {
     float v;
 } texture_t;
 
+// Returns the index of texel (x, y) in a tiled texture whose rows are `width` texels long.
+// The row length must be a multiple of TEXTURE_TILE_SIZE.
+//
+// Math:
+// 1. With T = TEXTURE_TILE_SIZE, the tile holding (x, y) starts at texel
+//    (y / T) * (width / T) * T² + (x / T) * T², and the texel is (y mod T) * T + (x mod T)
+//    inside it.
+// 2. (y / T) * (width / T) * T² is (y rounded down to T) * width, and (x / T) * T² + (y mod T) * T
+//    is ((x rounded down to T) + (y mod T)) * T, which only needs masks and shifts.
+static inline int tiledTexelIndex(int x, int y, int width)
+{
+    const int tileMask = TEXTURE_TILE_SIZE - 1;
+
+    return (y & ~tileMask) * width
+        + (((x & ~tileMask) | (y & tileMask)) << TEXTURE_TILE_SHIFT)
+        + (x & tileMask);
+}
+
 uint32_t* convertARGBtoRGBATexture(const uint32_t* src, int numPixels);
-void loadTextureFromPng(const char* filename, upng_t** png, uint32_t** texture);
+void tileTexture(uint32_t* tiled, const uint32_t* rowMajor, int stride, int width, int height);
+textureImage_t* createTexture(const uint32_t* texels, int width, int height, int wrap);
+textureImage_t* loadTextureFromPng(const char* filename, int wrap);
+void freeAllTextures();
 
 extern const uint8_t sampleTexture[];
 
@@ -0,0 +1,234 @@
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include "tiles.h"
+#include "display.h"
+
+#define MAX_RENDER_THREADS 64
+
+static int tilesX = 0;
+static int tilesY = 0;
+static int numberTiles = 0;
+
+// Triangle bins stored as one flat array: the triangles of tile `t` are
+// binnedTriangles[binOffsets[t]] .. binnedTriangles[binOffsets[t + 1] - 1].
+static int* binOffsets = NULL;
+static int* binCursors = NULL;
+static int* binnedTriangles = NULL;
+static int binnedCapacity = 0;
+
+static SDL_Thread* workers[MAX_RENDER_THREADS];
+static int numberWorkers = 0;
+static SDL_sem* frameStart = NULL;
+static SDL_sem* frameDone = NULL;
+static SDL_atomic_t nextTile;
+static bool isShuttingDown = false;
+static tileRenderFunction currentRenderTile = NULL;
+
+// Claims tiles one at a time until none are left, and renders each with exclusive
+// ownership of its pixels. Called by every render thread, including the main thread.
+static void renderAvailableTiles()
+{
+    int tile;
+
+    while ((tile = SDL_AtomicAdd(&nextTile, 1)) < numberTiles)
+    {
+        int tileX = tile % tilesX;
+        int tileY = tile / tilesX;
+
+        setClipRect(tileX * TILE_SIZE, tileY * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+        currentRenderTile(&binnedTriangles[binOffsets[tile]], binOffsets[tile + 1] - binOffsets[tile]);
+    }
+
+    resetClipRect();
+}
+
+// Entry point of a worker thread: waits for a frame to be started, helps render its
+// tiles and signals back when there are no tiles left.
+static int renderWorker(void* data)
+{
+    while (true)
+    {
+        SDL_SemWait(frameStart);
+
+        if (isShuttingDown) break;
+
+        renderAvailableTiles();
+        SDL_SemPost(frameDone);
+    }
+
+    return 0;
+}
+
+// Splits the window into TILE_SIZE x TILE_SIZE tiles and starts the render threads.
+// `numberThreads` counts the main thread, which also renders tiles; 0 or less picks
+// one thread per CPU core. With a single thread no worker threads are created.
+void initializeTiles(int numberThreads)
+{
+    if (numberThreads <= 0) numberThreads = SDL_GetCPUCount();
+    if (numberThreads > MAX_RENDER_THREADS) numberThreads = MAX_RENDER_THREADS;
+
+    tilesX = (getWindowWidth() + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (getWindowHeight() + TILE_SIZE - 1) / TILE_SIZE;
+    numberTiles = tilesX * tilesY;
+
+    binOffsets = calloc(numberTiles + 1, sizeof(int));
+    binCursors = calloc(numberTiles, sizeof(int));
+
+    frameStart = SDL_CreateSemaphore(0);
+    frameDone = SDL_CreateSemaphore(0);
+    isShuttingDown = false;
+
+    numberWorkers = 0;
+    for (int i = 1; i < numberThreads; i++)
+    {
+        SDL_Thread* worker = SDL_CreateThread(renderWorker, "render", NULL);
+        if (!worker) break;
+
+        workers[numberWorkers++] = worker;
+    }
+}
+
+// Stops the worker threads and frees the tile bins.
+void destroyTiles()
+{
+    isShuttingDown = true;
+
+    for (int i = 0; i < numberWorkers; i++)
+    {
+        SDL_SemPost(frameStart);
+    }
+
+    for (int i = 0; i < numberWorkers; i++)
+    {
+        SDL_WaitThread(workers[i], NULL);
+    }
+
+    numberWorkers = 0;
+
+    SDL_DestroySemaphore(frameStart);
+    SDL_DestroySemaphore(frameDone);
+    free(binOffsets);
+    free(binCursors);
+    free(binnedTriangles);
+    binOffsets = NULL;
+    binCursors = NULL;
+    binnedTriangles = NULL;
+    binnedCapacity = 0;
+}
+
+// Returns how many threads render tiles, including the main thread.
+int getNumberRenderThreads()
+{
+    return numberWorkers + 1;
+}
+
+// Computes the range of tiles touched by a screen-space triangle's bounding box.
+// The box uses the same integer conversion as the drawing functions, grown by
+// TILE_BIN_MARGIN. Returns false when the triangle is completely off-screen.
+static bool getTriangleTiles(const triangle_t* triangle, int* minTileX, int* minTileY, int* maxTileX, int* maxTileY)
+{
+    int minX = (int)triangle->points[0].x;
+    int minY = (int)triangle->points[0].y;
+    int maxX = minX;
+    int maxY = minY;
+
+    for (int v = 1; v < 3; v++)
+    {
+        int x = (int)triangle->points[v].x;
+        int y = (int)triangle->points[v].y;
+
+        if (x < minX) minX = x;
+        if (y < minY) minY = y;
+        if (x > maxX) maxX = x;
+        if (y > maxY) maxY = y;
+    }
+
+    minX -= TILE_BIN_MARGIN;
+    minY -= TILE_BIN_MARGIN;
+    maxX += TILE_BIN_MARGIN;
+    maxY += TILE_BIN_MARGIN;
+
+    if (maxX < 0 || maxY < 0 || minX >= getWindowWidth() || minY >= getWindowHeight()) return false;
+
+    *minTileX = minX > 0 ? minX / TILE_SIZE : 0;
+    *minTileY = minY > 0 ? minY / TILE_SIZE : 0;
+    *maxTileX = maxX / TILE_SIZE < tilesX - 1 ? maxX / TILE_SIZE : tilesX - 1;
+    *maxTileY = maxY / TILE_SIZE < tilesY - 1 ? maxY / TILE_SIZE : tilesY - 1;
+
+    return true;
+}
+
+// Sorts the frame's screen-space triangles into the tiles their bounding boxes overlap.
+// This is a two-pass counting sort: the first pass counts the triangles of each tile to
+// find where each bin starts, the second writes the triangle indices. Triangles are
+// visited in submission order, so every bin keeps the original drawing order and the
+// tiles produce exactly the same image as drawing the whole list on one thread.
+void binTriangles(const triangle_t* triangles, int numberTriangles)
+{
+    int minTileX, minTileY, maxTileX, maxTileY;
+
+    for (int t = 0; t <= numberTiles; t++)
+    {
+        binOffsets[t] = 0;
+    }
+
+    for (int i = 0; i < numberTriangles; i++)
+    {
+        if (!getTriangleTiles(&triangles[i], &minTileX, &minTileY, &maxTileX, &maxTileY)) continue;
+
+        for (int tileY = minTileY; tileY <= maxTileY; tileY++)
+        {
+            for (int tileX = minTileX; tileX <= maxTileX; tileX++)
+            {
+                binOffsets[tileY * tilesX + tileX + 1]++;
+            }
+        }
+    }
+
+    for (int t = 0; t < numberTiles; t++)
+    {
+        binOffsets[t + 1] += binOffsets[t];
+        binCursors[t] = binOffsets[t];
+    }
+
+    if (binOffsets[numberTiles] > binnedCapacity)
+    {
+        binnedCapacity = binOffsets[numberTiles] * 2;
+        binnedTriangles = realloc(binnedTriangles, sizeof(int) * binnedCapacity);
+    }
+
+    for (int i = 0; i < numberTriangles; i++)
+    {
+        if (!getTriangleTiles(&triangles[i], &minTileX, &minTileY, &maxTileX, &maxTileY)) continue;
+
+        for (int tileY = minTileY; tileY <= maxTileY; tileY++)
+        {
+            for (int tileX = minTileX; tileX <= maxTileX; tileX++)
+            {
+                binnedTriangles[binCursors[tileY * tilesX + tileX]++] = i;
+            }
+        }
+    }
+}
+
+// Renders every tile of the frame with `renderTile`, spread over all render threads.
+// Each tile is claimed by exactly one thread and drawn with a clip rectangle covering
+// only that tile, so no pixel is ever written by two threads and the color and depth
+// buffers need no locking. Returns once every tile is done.
+void renderTiles(tileRenderFunction renderTile)
+{
+    currentRenderTile = renderTile;
+    SDL_AtomicSet(&nextTile, 0);
+
+    for (int i = 0; i < numberWorkers; i++)
+    {
+        SDL_SemPost(frameStart);
+    }
+
+    renderAvailableTiles();
+
+    for (int i = 0; i < numberWorkers; i++)
+    {
+        SDL_SemWait(frameDone);
+    }
+}
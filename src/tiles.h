@@ -0,0 +1,25 @@
+#ifndef TILES
+#define TILES
+
+#include "triangle.h"
+
+// Tiles must be a multiple of DEPTH_BLOCK_SIZE, so every hierarchical depth block
+// belongs to exactly one tile (and one render thread).
+#define TILE_SIZE 64
+
+// Extra pixels added around a triangle's bounding box when binning it, so the small
+// squares drawn in vertex rendering mode land in every tile they touch.
+#define TILE_BIN_MARGIN 3
+
+// Draws everything that belongs to one tile. It is called once per tile per frame, on
+// any of the render threads, after the tile's clip rectangle has been set. The triangle
+// indices are in the same order the triangles were submitted to `binTriangles`.
+typedef void (*tileRenderFunction)(const int* triangleIndices, int numberTriangles);
+
+void initializeTiles(int numberThreads);
+void destroyTiles();
+int getNumberRenderThreads();
+void binTriangles(const triangle_t* triangles, int numberTriangles);
+void renderTiles(tileRenderFunction renderTile);
+
+#endif
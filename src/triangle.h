@@ -26,6 +26,8 @@ typedef struct {
     // The UV texture coordinates corresponding to each of the three vertices.
     // These are interpolated across the triangle's surface to map the texture.
     texture_t textureCoordinates[3];
+    // The texture of the mesh the triangle belongs to, or NULL when it has none.
+    const textureImage_t* texture;
     // The color of the triangle, typically calculated from lighting computations.
     // This color is used for flat shading or can be modulated with a texture.
     uint32_t color;
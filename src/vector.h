@@ -1,6 +1,13 @@
 #ifndef VECTOR
 #define VECTOR
 
+#include <math.h>
+
+// The vector functions are defined here, `static inline`, rather than in a source file of their
+// own: the geometry stage calls them several times per face, and a call into another
+// translation unit can't be inlined (without link-time optimization), which costs more than
+// most of these functions do. Inlined, their arguments and results stay in registers.
+
 // Represents a 2D vector with x and y components.
 // In 3D rendering, this is commonly used for:
 // - Texture coordinates (UV mapping) to map 2D textures onto 3D models.
@@ -35,32 +42,186 @@ typedef struct {
     float w;
 } vector4_t;
 
-vector2_t vector2Sum(vector2_t a, vector2_t b);
-vector2_t vector2Sub(vector2_t a, vector2_t b);
-vector2_t vector2Multiple(vector2_t a, vector2_t b);
+// Performs vector addition: c = a + b
+// (cx, cy) = (ax + bx, ay + by)
+static inline vector2_t vector2Sum(vector2_t a, vector2_t b)
+{
+    return (vector2_t){ a.x + b.x, a.y + b.y };
+}
+
+// Performs vector subtraction: c = a - b
+// (cx, cy) = (ax - bx, ay - by)
+static inline vector2_t vector2Sub(vector2_t a, vector2_t b)
+{
+    return (vector2_t){ a.x - b.x, a.y - b.y };
+}
+
+// Performs component-wise multiplication (Hadamard product): c = a * b
+// (cx, cy) = (ax * bx, ay * by)
+static inline vector2_t vector2Multiple(vector2_t a, vector2_t b)
+{
+    return (vector2_t){ a.x * b.x, a.y * b.y };
+}
+
+// Performs 3D vector addition: c = a + b
+// (cx, cy, cz) = (ax + bx, ay + by, az + bz)
+static inline vector3_t vector3Sum(vector3_t a, vector3_t b)
+{
+    return (vector3_t){ a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+// Performs 3D vector subtraction: c = a - b
+// (cx, cy, cz) = (ax - bx, ay - by, az - bz)
+static inline vector3_t vector3Sub(vector3_t a, vector3_t b)
+{
+    return (vector3_t){ a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+// Performs 3D component-wise multiplication (Hadamard product): c = a * b
+// (cx, cy, cz) = (ax * bx, ay * by, az * bz)
+static inline vector3_t vector3Multiple(vector3_t a, vector3_t b)
+{
+    return (vector3_t){ a.x * b.x, a.y * b.y, a.z * b.z };
+}
+
+// Rotates a 3D vector around the X-axis by a given angle.
+// This is a 2D rotation in the YZ-plane.
+// x' = x
+// y' = y*cos(angle) - z*sin(angle)
+// z' = y*sin(angle) + z*cos(angle)
+static inline vector3_t vector3RotateX(vector3_t vector, float angle)
+{
+    vector3_t rotatedVector = {
+        .x = vector.x,
+        .y = vector.y * cos(angle) - vector.z * sin(angle),
+        .z = vector.y * sin(angle) + vector.z * cos(angle)
+    };
+
+    return rotatedVector;
+}
+
+// Rotates a 3D vector around the Y-axis by a given angle.
+// This is a 2D rotation in the XZ-plane.
+// x' = x*cos(angle) - z*sin(angle)
+// y' = y
+// z' = x*sin(angle) + z*cos(angle)
+static inline vector3_t vector3RotateY(vector3_t vector, float angle)
+{
+    vector3_t rotatedVector = {
+        .x = vector.x * cos(angle) - vector.z * sin(angle),
+        .y = vector.y,
+        .z = vector.x * sin(angle) + vector.z * cos(angle)
+    };
+
+    return rotatedVector;
+}
+
+// Rotates a 3D vector around the Z-axis by a given angle.
+// This is a 2D rotation in the XY-plane.
+// x' = x*cos(angle) - y*sin(angle)
+// y' = x*sin(angle) + y*cos(angle)
+// z' = z
+static inline vector3_t vector3RotateZ(vector3_t vector, float angle)
+{
+    vector3_t rotatedVector = {
+        .x = vector.x * cos(angle) - vector.y * sin(angle),
+        .y = vector.x * sin(angle) + vector.y * cos(angle),
+        .z = vector.z
+    };
+
+    return rotatedVector;
+}
+
+// Calculates the magnitude (length) of a 2D vector using the Pythagorean theorem.
+// ||v|| = sqrt(x^2 + y^2)
+static inline float vector2Magnitude(const vector2_t vector)
+{
+    return sqrt(vector.x * vector.x + vector.y * vector.y);
+}
+
+// Calculates the magnitude (length) of a 3D vector using the Pythagorean theorem in 3D.
+// ||v|| = sqrt(x^2 + y^2 + z^2)
+static inline float vector3Magnitude(const vector3_t vector)
+{
+    return sqrt(vector.x * vector.x + vector.y * vector.y + vector.z * vector.z);
+}
+
+// Calculates the cross product of two 3D vectors, a x b.
+// The resulting vector is perpendicular to both a and b.
+// cx = ay*bz - az*by
+// cy = az*bx - ax*bz
+// cz = ax*by - ay*bx
+static inline vector3_t vector3CrossProduct(vector3_t a, vector3_t b)
+{
+    vector3_t crossProduct = {
+        .x = a.y * b.z - a.z * b.y,
+        .y = a.z * b.x - a.x * b.z,
+        .z = a.x * b.y - a.y * b.x
+    };
+
+    return crossProduct;
+}
+
+// Calculates the dot product of two 3D vectors, a . b.
+// The result is a scalar value.
+// a . b = ax*bx + ay*by + az*bz
+static inline float vector3DotProduct(vector3_t a, vector3_t b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Normalizes a 2D vector, resulting in a unit vector (length of 1).
+// v_normalized = v / ||v||
+static inline vector2_t vector2Normalized(vector2_t vector)
+{
+    float magnitude = vector2Magnitude(vector);
+    if (magnitude == 0) return vector;
+
+    return (vector2_t){ vector.x / magnitude, vector.y / magnitude };
+}
 
-vector3_t vector3Sum(vector3_t a, vector3_t b);
-vector3_t vector3Sub(vector3_t a, vector3_t b);
-vector3_t vector3Multiple(vector3_t a, vector3_t b);
+// Normalizes a 3D vector, resulting in a unit vector (length of 1).
+// v_normalized = v / ||v||
+static inline vector3_t vector3Normalized(vector3_t vector)
+{
+    float magnitude = vector3Magnitude(vector);
+    if (magnitude == 0) return vector;
 
-vector3_t vector3RotateX(vector3_t vector, float angle);
-vector3_t vector3RotateY(vector3_t vector, float angle);
-vector3_t vector3RotateZ(vector3_t vector, float angle);
+    return (vector3_t){ vector.x / magnitude, vector.y / magnitude, vector.z / magnitude };
+}
 
-float vector2Magnitude(vector2_t vector);
-float vector3Magnitude(vector3_t vector);
+// Converts a 3D vector to a 4D vector (homogeneous coordinates).
+// The w-component is set to 1.0, indicating it's a point in 3D space.
+static inline vector4_t vector3to4(vector3_t vector)
+{
+    return (vector4_t){ vector.x, vector.y, vector.z, 1 };
+}
 
-vector3_t vector3CrossProduct(vector3_t a, vector3_t b);
-float vector3DotProduct(vector3_t a, vector3_t b);
+// Converts a 4D vector (homogeneous coordinates) to a 3D vector.
+// The w-component is discarded.
+static inline vector3_t vector4to3(vector4_t vector)
+{
+    return (vector3_t){ vector.x, vector.y, vector.z };
+}
 
-vector2_t vector2Normalized(vector2_t vector);
-vector3_t vector3Normalized(vector3_t vector);
+// Converts a 4D vector to a 2D vector.
+// The z and w components are discarded.
+static inline vector2_t vector4to2(vector4_t vector)
+{
+    return (vector2_t){ vector.x, vector.y };
+}
 
-vector4_t vector3to4(vector3_t vector);
-vector3_t vector4to3(vector4_t vector);
-vector2_t vector4to2(vector4_t vector);
+// Creates a new 3D zero vector.
+// v = (0, 0, 0)
+static inline vector3_t vector3New()
+{
+    return (vector3_t){ 0, 0, 0 };
+}
 
-vector3_t vector3New();
-vector3_t vector3Clone(vector3_t vector);
+// Creates a copy of a 3D vector.
+static inline vector3_t vector3Clone(vector3_t vector)
+{
+    return (vector3_t){ vector.x, vector.y, vector.z };
+}
 
 #endif
\ No newline at end of file
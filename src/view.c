@@ -0,0 +1,91 @@
+#include "view.h"
+#include "display.h"
+
+// Creates a view of the scene from a camera, looking through the viewport at (x, y) of
+// `width` x `height` pixels.
+// The vertical field of view is fixed, and the horizontal one follows from the viewport's
+// aspect ratio, so the projection fills the viewport without stretching. The view's triangles
+// are clipped in the clip space of its projection matrix, so the frustum always matches it,
+// and so do the world-space frustum planes its meshes are culled against.
+// The guard band only reaches past the viewport on the sides where nothing else is drawn,
+// the window's edges, so a view never draws over its neighbours.
+view_t makeView(camera_t camera, vector3_t up, float fovY, float zNear, float zFar, int x, int y, int width, int height)
+{
+    view_t view = {
+        .camera = camera,
+        .up = up,
+        .x = x,
+        .y = y,
+        .width = width,
+        .height = height
+    };
+
+    float aspectY = (float)height / (float)width;
+
+    view.projectionMatrix = matrix4MakePerspective(fovY, aspectY, zNear, zFar);
+
+    matrix4_t viewMatrix = getViewMatrix(&view);
+    view.viewProjectionMatrix = matrix4MultiplyMatrix4(&view.projectionMatrix, &viewMatrix);
+    extractFrustumPlanes(&view.viewProjectionMatrix, view.frustumPlanes);
+
+    view.guardMinX = x > 0 ? x : -GUARD_BAND_SIZE;
+    view.guardMinY = y > 0 ? y : -GUARD_BAND_SIZE;
+    view.guardMaxX = x + width < getWindowWidth() ? x + width : getWindowWidth() + GUARD_BAND_SIZE;
+    view.guardMaxY = y + height < getWindowHeight() ? y + height : getWindowHeight() + GUARD_BAND_SIZE;
+
+    return view;
+}
+
+// Returns the matrix that transforms world space into the view's camera space, looking from
+// the camera's position along its direction.
+matrix4_t getViewMatrix(const view_t* view)
+{
+    vector3_t eye = view->camera.position;
+    vector3_t target = vector3Sum(view->camera.position, view->camera.direction);
+
+    return matrix4LookAt(&eye, &target, &view->up);
+}
+
+// Projects a point from the view's clip space (a camera-space point multiplied by the
+// projection matrix) onto its viewport: the perspective division, then the viewport mapping.
+// x and y become window pixel coordinates (y pointing down), z the projected depth, and w,
+// the camera-space depth, is kept for perspective-correct interpolation.
+vector4_t projectToView(const view_t* view, const vector4_t* point)
+{
+    vector4_t projectedPoint = *point;
+
+    if (projectedPoint.w != 0.0f) {
+        projectedPoint.x /= projectedPoint.w;
+        projectedPoint.y /= projectedPoint.w;
+        projectedPoint.z /= projectedPoint.w;
+    }
+
+    projectedPoint.x *= view->width / 2.0;
+    projectedPoint.y *= view->height / 2.0;
+
+    projectedPoint.y *= -1;
+
+    projectedPoint.x += view->width / 2.0 + view->x;
+    projectedPoint.y += view->height / 2.0 + view->y;
+
+    return projectedPoint;
+}
+
+// Whether a triangle can skip clipping: all its vertices project inside the view's guard
+// band. The rasterizer then limits it to the window (its bounding box is clamped to the clip
+// rectangle), which is far cheaper than clipping it against the side planes and gives the
+// same pixels. Only triangles crossing the near or far plane, or reaching far past the
+// window, still need `clipPolygon`.
+// `screenPoints` are the vertices after `projectToView`. They are only meaningful for
+// vertices between the near and far planes, so the caller must have checked their outcodes
+// against OUTCODE_NEAR_FAR first.
+bool isInsideGuardBand(const view_t* view, const vector4_t screenPoints[3])
+{
+    for (int v = 0; v < 3; v++)
+    {
+        if (screenPoints[v].x < view->guardMinX || screenPoints[v].x > view->guardMaxX) return false;
+        if (screenPoints[v].y < view->guardMinY || screenPoints[v].y > view->guardMaxY) return false;
+    }
+
+    return true;
+}
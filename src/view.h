@@ -0,0 +1,38 @@
+#ifndef VIEW
+#define VIEW
+
+#include <stdbool.h>
+#include "camera.h"
+#include "matrix.h"
+#include "clipping.h"
+
+// Maximum number of views rendered in one frame (a cube map capture needs 6).
+#define MAX_VIEWS 6
+
+// One view of the scene: a camera seen through a rectangle of the window, its viewport.
+// Several views share the geometry processing of a frame: every mesh is transformed into
+// world space once, and only the view transformation, clipping and projection are repeated
+// per view. Each view's triangles are mapped into its own viewport.
+typedef struct {
+    camera_t camera;
+    // The camera's up direction; it must not be parallel to the camera's direction.
+    vector3_t up;
+    // Viewport: top-left pixel and size.
+    int x, y, width, height;
+    // Derived from the field of view and the viewport's aspect ratio by `makeView`.
+    matrix4_t projectionMatrix;
+    // The projection matrix times the view matrix: from world space to clip space.
+    matrix4_t viewProjectionMatrix;
+    // The world-space planes of the view frustum, to cull bounding volumes (see `extractFrustumPlanes`).
+    vector4_t frustumPlanes[FRUSTUM_NUM_PLANES];
+    // Screen-space rectangle the view's triangles can reach without being clipped: the
+    // viewport, grown by GUARD_BAND_SIZE on the sides that are also window edges.
+    float guardMinX, guardMinY, guardMaxX, guardMaxY;
+} view_t;
+
+view_t makeView(camera_t camera, vector3_t up, float fovY, float zNear, float zFar, int x, int y, int width, int height);
+matrix4_t getViewMatrix(const view_t* view);
+vector4_t projectToView(const view_t* view, const vector4_t* point);
+bool isInsideGuardBand(const view_t* view, const vector4_t screenPoints[3]);
+
+#endif